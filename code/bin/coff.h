@@ -47,3 +47,57 @@ struct scnhdr {
         long            s_flags;        /* flags */
       };
  
+
+/* The symbol table (only the parts coffprof needs).  f_symptr in the
+ * file header points to the symbolic header; the external symbols
+ * and their names are where it says.
+ */
+
+#define SYMHDRMAGIC     0x7009
+
+typedef struct symhdr {
+        short   magic;          /* SYMHDRMAGIC                          */
+        short   vstamp;         /* version stamp                        */
+        long    ilineMax;       /* number of line number entries        */
+        long    cbLine;         /* number of bytes of line numbers      */
+        long    cbLineOffset;   /* offset to line numbers               */
+        long    idnMax;         /* max index into dense numbers         */
+        long    cbDnOffset;     /* offset to dense numbers              */
+        long    ipdMax;         /* number of procedures                 */
+        long    cbPdOffset;     /* offset to procedure descriptors      */
+        long    isymMax;        /* number of local symbols              */
+        long    cbSymOffset;    /* offset to local symbols              */
+        long    ioptMax;        /* max index into optimization entries  */
+        long    cbOptOffset;    /* offset to optimization entries       */
+        long    iauxMax;        /* number of auxiliary symbols          */
+        long    cbAuxOffset;    /* offset to auxiliary symbols          */
+        long    issMax;         /* max index into local strings         */
+        long    cbSsOffset;     /* offset to local strings              */
+        long    issExtMax;      /* max index into external strings      */
+        long    cbSsExtOffset;  /* offset to external strings           */
+        long    ifdMax;         /* number of file descriptors           */
+        long    cbFdOffset;     /* offset to file descriptors           */
+        long    crfd;           /* number of relative file descriptors  */
+        long    cbRfdOffset;    /* offset to relative file descriptors  */
+        long    iextMax;        /* number of external symbols           */
+        long    cbExtOffset;    /* offset to external symbols           */
+      } HDRR;
+
+typedef struct {
+        long            iss;            /* index of name in string space */
+        long            value;          /* address, for a procedure */
+        unsigned        st : 6;         /* symbol type */
+        unsigned        sc : 5;         /* storage class */
+        unsigned        reserved : 1;
+        unsigned        index : 20;
+      } SYMR;
+
+typedef struct {
+        unsigned short  flags;          /* jmptbl, cobol_main, weakext */
+        short           ifd;            /* file the symbol is defined in */
+        SYMR            asym;
+      } EXTR;
+
+#define stProc          6               /* st: a procedure */
+#define stStaticProc    14              /* st: a static procedure */
+#define scText          1               /* sc: in the text segment */
@@ -0,0 +1,210 @@
+/* coffprof.c
+ *
+ * This program reads a flat profile written by "nachos -prof", and
+ * the COFF file of the user program that was profiled, and prints
+ * how many ticks of user time were spent (and how many memory stalls
+ * taken) in each procedure, busiest first.  Then it prints the counts
+ * by opcode and by kind of stall, as recorded in the profile.
+ *
+ * Each address is charged to the procedure with the highest starting
+ * address at or below it.  Only the external symbols of the COFF file
+ * are looked at, so the time in a static procedure is charged to the
+ * procedure before it.
+ *
+ * Like coff2noff, this assumes the host's "long" is 32 bits; like
+ * disassemble, it doesn't support big endian hosts yet.
+ *
+ * Copyright (c) 1992-1993 The Regents of the University of California.
+ * All rights reserved.  See copyright.h for copyright notice and limitation
+ * of liability and disclaimer of warranty provisions.
+ */
+
+#define MAIN
+#include "copyright.h"
+#undef MAIN
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "coff.h"
+
+typedef struct {
+    char *name;			/* procedure name */
+    long start;			/* its first address */
+    long hits;			/* ticks spent in it */
+    long stalls;		/* memory stalls taken in it */
+} Proc;
+
+#define ReadStruct(f,s) 	Read(f,(char *)&s,sizeof(s))
+
+/* read and check for error */
+void Read(int fd, char *buf, int nBytes)
+{
+    if (read(fd, buf, nBytes) != nBytes) {
+        fprintf(stderr, "File is too short\n");
+	exit(1);
+    }
+}
+
+int ByStart(const void *a, const void *b)
+{
+    long x = ((Proc *) a)->start, y = ((Proc *) b)->start;
+
+    return (x < y) ? -1 : (x > y);
+}
+
+int ByHits(const void *a, const void *b)
+{
+    long x = ((Proc *) a)->hits, y = ((Proc *) b)->hits;
+
+    return (x > y) ? -1 : (x < y);
+}
+
+/* Read the procedures out of the external symbols of a COFF file;
+ * return how many there are, sorted by address.
+ */
+int ReadProcs(char *coffFileName, Proc **procsPtr)
+{
+    int fd, i, numProcs = 0;
+    struct filehdr fileh;
+    HDRR symh;
+    EXTR ext;
+    char *strings;
+    Proc *procs;
+
+    fd = open(coffFileName, O_RDONLY, 0);
+    if (fd == -1) {
+	perror(coffFileName);
+	exit(1);
+    }
+    ReadStruct(fd, fileh);
+    if (fileh.f_magic != MIPSELMAGIC) {
+	fprintf(stderr, "File is not a MIPSEL COFF file\n");
+	exit(1);
+    }
+    lseek(fd, fileh.f_symptr, 0);
+    ReadStruct(fd, symh);
+    if (fileh.f_symptr == 0 || symh.magic != SYMHDRMAGIC) {
+	fprintf(stderr, "File has no symbol table\n");
+	exit(1);
+    }
+
+    strings = malloc(symh.issExtMax + 1);
+    lseek(fd, symh.cbSsExtOffset, 0);
+    Read(fd, strings, symh.issExtMax);
+    strings[symh.issExtMax] = '\0';
+
+    procs = (Proc *) malloc((symh.iextMax + 1) * sizeof(Proc));
+    lseek(fd, symh.cbExtOffset, 0);
+    for (i = 0; i < symh.iextMax; i++) {
+	ReadStruct(fd, ext);
+	if ((ext.asym.st == stProc || ext.asym.st == stStaticProc)
+		&& ext.asym.sc == scText && ext.asym.iss < symh.issExtMax) {
+	    procs[numProcs].name = &strings[ext.asym.iss];
+	    procs[numProcs].start = ext.asym.value;
+	    procs[numProcs].hits = procs[numProcs].stalls = 0;
+	    numProcs++;
+	}
+    }
+    close(fd);
+    qsort(procs, numProcs, sizeof(Proc), ByStart);
+    *procsPtr = procs;
+    return numProcs;
+}
+
+/* Return the procedure "addr" is in, or NULL if it is before them all. */
+Proc *FindProc(Proc *procs, int numProcs, long addr)
+{
+    int low = 0, high = numProcs - 1, mid;
+
+    if (numProcs == 0 || addr < procs[0].start)
+	return NULL;
+    while (low < high) {		/* last procs[i].start <= addr */
+	mid = (low + high + 1) / 2;
+	if (procs[mid].start <= addr)
+	    low = mid;
+	else
+	    high = mid - 1;
+    }
+    return &procs[low];
+}
+
+int main(int argc, char **argv)
+{
+    FILE *prof;
+    Proc *procs, *p, unknown;
+    int numProcs, i;
+    long addr, hits, stalls, data, fetch, total = 0, totalStalls = 0;
+    char key[20], name[20];
+
+    if (argc < 3) {
+	fprintf(stderr, "Usage: %s <coffFileName> <profileFileName>\n",
+		argv[0]);
+	exit(1);
+    }
+    numProcs = ReadProcs(argv[1], &procs);
+    unknown.name = "<unknown>";
+    unknown.hits = unknown.stalls = 0;
+
+    prof = fopen(argv[2], "r");
+    if (prof == NULL) {
+	perror(argv[2]);
+	exit(1);
+    }
+
+/* Charge each address to its procedure. */
+    while (fscanf(prof, "%19s", key) == 1) {
+	if (!strcmp(key, "total")) {
+	    if (fscanf(prof, "%ld %ld", &total, &totalStalls) != 2)
+		break;
+	} else if (!strcmp(key, "pc")) {
+	    if (fscanf(prof, "%lx %ld %ld", &addr, &hits, &stalls) != 3)
+		break;
+	    p = FindProc(procs, numProcs, addr);
+	    if (p == NULL)
+		p = &unknown;
+	    p->hits += hits;
+	    p->stalls += stalls;
+	} else
+	    break;
+    }
+    procs[numProcs++] = unknown;
+    qsort(procs, numProcs, sizeof(Proc), ByHits);
+
+    printf("Flat profile: %ld ticks, %ld memory stalls\n\n",
+	   total, totalStalls);
+    printf("  %%time   cumulative          ticks   stalls   procedure\n");
+    hits = 0;
+    for (i = 0; i < numProcs && procs[i].hits + procs[i].stalls > 0; i++) {
+	hits += procs[i].hits;
+	printf("%7.2f %12ld %14ld %8ld   %s\n",
+	       total ? 100.0 * procs[i].hits / total : 0.0, hits,
+	       procs[i].hits, procs[i].stalls, procs[i].name);
+    }
+
+/* The rest of the profile: counts by opcode, then by kind of stall. */
+    printf("\n  %%time   instructions   opcode\n");
+    while (!strcmp(key, "op")) {
+	if (fscanf(prof, "%19s %ld", name, &hits) != 2)
+	    break;
+	printf("%7.2f %14ld   %s\n", total ? 100.0 * hits / total : 0.0,
+	       hits, name);
+	if (fscanf(prof, "%19s", key) != 1)
+	    break;
+    }
+    printf("\n        data        fetch   memory stall\n");
+    while (!strcmp(key, "stall")) {
+	if (fscanf(prof, "%19s %ld %ld", name, &data, &fetch) != 3)
+	    break;
+	printf("%12ld %12ld   %s\n", data, fetch, name);
+	if (fscanf(prof, "%19s", key) != 1)
+	    break;
+    }
+    fclose(prof);
+    exit(0);
+}
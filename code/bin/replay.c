@@ -0,0 +1,608 @@
+/* replay.c
+ *
+ * This program reads a trace of the pages referred to by user programs,
+ * as written by "nachos -trace", and replays it against several TLB
+ * and page replacement policies, for any number of TLB entries and
+ * physical pages.  For each size, it prints how many misses each policy
+ * takes, and for physical memory, how many dirty pages it writes back.
+ *
+ * The policies are:
+ *	FIFO	replace the page loaded longest ago (TLBVictim)
+ *	LRU	replace the page used longest ago (TLBVictim)
+ *	OPT	replace the page used furthest in the future (Belady)
+ *	CLOCK	second chance, on a use bit per page
+ *	ARC	adaptive replacement cache (Megiddo and Modha)
+ *	NACHOS	like LRU, but replace one of the faulting thread's own
+ *		pages if it has any (PageTableFetch); memory only
+ *
+ * As in Nachos, the TLB is flushed whenever another thread starts
+ * referring to memory, unless -asid is given, in which case each entry
+ * is tagged with its thread.  Physical memory is shared by all threads.
+ * When a thread exits, its pages are dropped without being written back.
+ *
+ * The trace is in the host's byte order, so it must be replayed on a
+ * host of the same endianness as the one that recorded it.
+ *
+ * Copyright (c) 1992-1993 The Regents of the University of California.
+ * All rights reserved.  See copyright.h for copyright notice and limitation
+ * of liability and disclaimer of warranty provisions.
+ */
+
+#define MAIN
+#include "copyright.h"
+#undef MAIN
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* must match ../machine/trace.h */
+#define TraceMagic	0x4e545243
+#define TraceExitPage	0xffffff
+
+typedef struct {
+    int magic;
+    int pageSize;
+    int numPhysPages;
+    int tlbSize;
+} TraceHeader;
+
+enum { FIFO, LRU, OPT, CLOCK, ARC, NACHOS, NumPolicies };
+char *policyNames[] = { "FIFO", "LRU", "OPT", "CLOCK", "ARC", "NACHOS" };
+
+#define MaxSizes	32
+#define MaxThreads	128
+
+/* ARC's lists */
+enum { None, T1, T2, B1, B2, NumLists };
+
+/* The trace, with each page (a virtual page of a thread) numbered
+ * densely from 0 in the order first referred to.
+ */
+int numRefs;			/* references, including exits */
+int *refs;			/* page * 2 + write, or -1 - tid for an exit */
+int *nextUse;			/* index of the next reference to the same
+				 * page, or numRefs if none */
+int numPages;
+int *pageTid;			/* the thread each page belongs to */
+
+typedef struct {
+    int policy;
+    int size;			/* how many pages fit */
+    int asid;			/* TRUE if not flushed on a thread switch */
+    long misses, writebacks;
+
+    /* every policy but ARC keeps the pages in frames */
+    int *frameOf;		/* frame of each page, or -1 */
+    int *framePage;		/* page in each frame, or -1 */
+    long *stamp;		/* FIFO: time loaded; LRU, NACHOS: time
+				 * last used; OPT: time of next use */
+    char *use;			/* CLOCK: use bits */
+    int hand;			/* CLOCK: next frame to look at */
+    int *freeFrames, numFree;
+
+    /* ARC keeps the pages on four lists, most recently used first */
+    char *list;			/* list each page is on */
+    int *prev, *next;
+    int head[NumLists], tail[NumLists], length[NumLists];
+    int target;			/* ARC's "p": the length wanted for T1 */
+
+    char *dirty;		/* written since loaded, by page */
+} Cache;
+
+/* read and check for error */
+void Read(int fd, char *buf, int nBytes)
+{
+    if (read(fd, buf, nBytes) != nBytes) {
+        fprintf(stderr, "File is too short\n");
+	exit(1);
+    }
+}
+
+void *Allocate(long nBytes)
+{
+    void *p = malloc(nBytes > 0 ? nBytes : 1);
+
+    if (p == NULL) {
+	fprintf(stderr, "Out of memory\n");
+	exit(1);
+    }
+    return p;
+}
+
+/* Read in the trace, numbering the pages as we go. */
+void ReadTrace(char *fileName, TraceHeader *header,
+	       long *numWrites, int *numThreads, int *numExits)
+{
+    int fd, i, slot, tableSize = 1024, *table, *keys;
+    unsigned int word, key;
+    unsigned int *words;
+    struct stat st;
+    char seen[MaxThreads];
+
+    fd = open(fileName, O_RDONLY, 0);
+    if (fd == -1) {
+	perror(fileName);
+	exit(1);
+    }
+    fstat(fd, &st);
+    Read(fd, (char *) header, sizeof(TraceHeader));
+    if (header->magic != TraceMagic) {
+	fprintf(stderr, "File is not a Nachos trace\n");
+	exit(1);
+    }
+    numRefs = (st.st_size - sizeof(TraceHeader)) / sizeof(unsigned int);
+    words = (unsigned int *) Allocate((long) numRefs * sizeof(unsigned int));
+    Read(fd, (char *) words, numRefs * sizeof(unsigned int));
+    close(fd);
+
+    /* a hash table from (vpn, tid) to page number */
+    table = (int *) Allocate(tableSize * sizeof(int));
+    memset(table, -1, tableSize * sizeof(int));
+    keys = (int *) Allocate(tableSize * sizeof(int));
+    pageTid = (int *) Allocate(tableSize * sizeof(int));
+
+    refs = (int *) Allocate((long) numRefs * sizeof(int));
+    memset(seen, 0, sizeof(seen));
+    *numWrites = *numThreads = *numExits = 0;
+    numPages = 0;
+    for (i = 0; i < numRefs; i++) {
+	word = words[i];
+	key = word >> 1;
+	if ((word >> 8) == TraceExitPage) {
+	    refs[i] = -1 - (int) (key & 0x7f);
+	    (*numExits)++;
+	    continue;
+	}
+	if (!seen[key & 0x7f]) {
+	    seen[key & 0x7f] = 1;
+	    (*numThreads)++;
+	}
+	*numWrites += word & 1;
+	for (slot = (key * 2654435761u) & (tableSize - 1);
+		table[slot] != -1 && keys[table[slot]] != (int) key;
+		slot = (slot + 1) & (tableSize - 1))
+	    ;
+	if (table[slot] == -1) {
+	    if (numPages * 2 == tableSize) {	/* full: double everything */
+		int page;
+
+		tableSize *= 2;
+		keys = (int *) realloc(keys, tableSize * sizeof(int));
+		pageTid = (int *) realloc(pageTid, tableSize * sizeof(int));
+		free(table);
+		table = (int *) Allocate(tableSize * sizeof(int));
+		memset(table, -1, tableSize * sizeof(int));
+		for (page = 0; page < numPages; page++) {
+		    for (slot = (keys[page] * 2654435761u) & (tableSize - 1);
+			    table[slot] != -1; slot = (slot + 1) & (tableSize - 1))
+			;
+		    table[slot] = page;
+		}
+		for (slot = (key * 2654435761u) & (tableSize - 1);
+			table[slot] != -1; slot = (slot + 1) & (tableSize - 1))
+		    ;
+	    }
+	    keys[numPages] = key;
+	    pageTid[numPages] = key & 0x7f;
+	    table[slot] = numPages++;
+	}
+	refs[i] = table[slot] * 2 + (word & 1);
+    }
+    free(words);
+    free(table);
+    free(keys);
+}
+
+/* For OPT: find when each page is next referred to.  An exit ends the
+ * life of all the thread's pages, even if the thread id is used again.
+ */
+void FindNextUses()
+{
+    int *last = (int *) Allocate(numPages * sizeof(int));
+    int i, page;
+
+    nextUse = (int *) Allocate((long) numRefs * sizeof(int));
+    for (page = 0; page < numPages; page++)
+	last[page] = numRefs;
+    for (i = numRefs - 1; i >= 0; i--) {
+	if (refs[i] < 0) {
+	    for (page = 0; page < numPages; page++)
+		if (pageTid[page] == -1 - refs[i])
+		    last[page] = numRefs;
+	    nextUse[i] = numRefs;
+	} else {
+	    page = refs[i] / 2;
+	    nextUse[i] = last[page];
+	    last[page] = i;
+	}
+    }
+    free(last);
+}
+
+/*----------------------------------------------------------------------
+ * ARC's lists
+ *----------------------------------------------------------------------*/
+
+void ListRemove(Cache *c, int page)
+{
+    int l = c->list[page];
+
+    if (c->prev[page] != -1)
+	c->next[c->prev[page]] = c->next[page];
+    else
+	c->head[l] = c->next[page];
+    if (c->next[page] != -1)
+	c->prev[c->next[page]] = c->prev[page];
+    else
+	c->tail[l] = c->prev[page];
+    c->length[l]--;
+    c->list[page] = None;
+}
+
+void ListPush(Cache *c, int l, int page)	/* to the front of list l */
+{
+    if (c->list[page] != None)
+	ListRemove(c, page);
+    c->list[page] = l;
+    c->prev[page] = -1;
+    c->next[page] = c->head[l];
+    if (c->head[l] != -1)
+	c->prev[c->head[l]] = page;
+    else
+	c->tail[l] = page;
+    c->head[l] = page;
+    c->length[l]++;
+}
+
+/*----------------------------------------------------------------------
+ * The caches
+ *----------------------------------------------------------------------*/
+
+void Evict(Cache *c, int page)
+{
+    if (c->dirty[page]) {
+	c->writebacks++;
+	c->dirty[page] = 0;
+    }
+}
+
+void Init(Cache *c, int policy, int size, int asid)
+{
+    int i;
+
+    c->policy = policy;
+    c->size = size;
+    c->asid = asid;
+    c->misses = c->writebacks = 0;
+    c->frameOf = (int *) Allocate(numPages * sizeof(int));
+    c->framePage = (int *) Allocate(size * sizeof(int));
+    c->stamp = (long *) Allocate(size * sizeof(long));
+    c->use = (char *) Allocate(size);
+    c->freeFrames = (int *) Allocate(size * sizeof(int));
+    c->list = (char *) Allocate(numPages);
+    c->prev = (int *) Allocate(numPages * sizeof(int));
+    c->next = (int *) Allocate(numPages * sizeof(int));
+    c->dirty = (char *) Allocate(numPages);
+    for (i = 0; i < numPages; i++) {
+	c->frameOf[i] = -1;
+	c->list[i] = None;
+	c->dirty[i] = 0;
+    }
+    for (i = 0; i < size; i++) {
+	c->framePage[i] = -1;
+	c->freeFrames[i] = size - 1 - i;
+    }
+    c->numFree = size;
+    c->hand = 0;
+    for (i = 0; i < NumLists; i++) {
+	c->head[i] = c->tail[i] = -1;
+	c->length[i] = 0;
+    }
+    c->target = 0;
+}
+
+void Free(Cache *c)
+{
+    free(c->frameOf);
+    free(c->framePage);
+    free(c->stamp);
+    free(c->use);
+    free(c->freeFrames);
+    free(c->list);
+    free(c->prev);
+    free(c->next);
+    free(c->dirty);
+}
+
+/* Forget the pages of thread "tid", or of every thread if "tid" is -1,
+ * without writing them back.
+ */
+void Drop(Cache *c, int tid)
+{
+    int f, page;
+
+    if (c->policy == ARC) {
+	for (page = 0; page < numPages; page++)
+	    if (c->list[page] != None && (tid == -1 || pageTid[page] == tid)) {
+		ListRemove(c, page);
+		c->dirty[page] = 0;
+	    }
+	if (tid == -1)
+	    c->target = 0;
+	return;
+    }
+    for (f = 0; f < c->size; f++) {
+	page = c->framePage[f];
+	if (page != -1 && (tid == -1 || pageTid[page] == tid)) {
+	    c->frameOf[page] = -1;
+	    c->framePage[f] = -1;
+	    c->dirty[page] = 0;
+	    c->freeFrames[c->numFree++] = f;
+	}
+    }
+}
+
+/* Choose a frame to replace, for a reference by "tid". */
+int Victim(Cache *c, int tid)
+{
+    int f, best = -1, mine = -1;
+
+    switch (c->policy) {
+      case CLOCK:
+	while (c->use[c->hand]) {
+	    c->use[c->hand] = 0;
+	    c->hand = (c->hand + 1) % c->size;
+	}
+	best = c->hand;
+	c->hand = (c->hand + 1) % c->size;
+	return best;
+      case OPT:
+	for (f = 0; f < c->size; f++)
+	    if (best == -1 || c->stamp[f] > c->stamp[best])
+		best = f;
+	return best;
+      default:			/* FIFO, LRU, NACHOS */
+	for (f = 0; f < c->size; f++) {
+	    if (best == -1 || c->stamp[f] < c->stamp[best])
+		best = f;
+	    if (pageTid[c->framePage[f]] == tid
+		    && (mine == -1 || c->stamp[f] < c->stamp[mine]))
+		mine = f;
+	}
+	return (c->policy == NACHOS && mine != -1) ? mine : best;
+    }
+}
+
+/* ARC: make room for "page" by moving a page out of T1 or T2. */
+void Replace(Cache *c, int page)
+{
+    int victim;
+
+    if (c->length[T1] + c->length[T2] < c->size)
+	return;				/* room left by an exit */
+    if (c->length[T2] == 0 || (c->length[T1] > 0
+	    && (c->length[T1] > c->target
+		|| (c->list[page] == B2 && c->length[T1] == c->target)))) {
+	victim = c->tail[T1];
+	ListPush(c, B1, victim);
+    } else {
+	victim = c->tail[T2];
+	ListPush(c, B2, victim);
+    }
+    Evict(c, victim);
+}
+
+/* ARC: refer to "page"; return TRUE on a hit. */
+int AccessARC(Cache *c, int page)
+{
+    int delta;
+
+    switch (c->list[page]) {
+      case T1:
+      case T2:
+	ListPush(c, T2, page);
+	return 1;
+      case B1:
+	delta = c->length[B2] > c->length[B1] ?
+	    c->length[B2] / c->length[B1] : 1;
+	c->target = c->target + delta < c->size ? c->target + delta : c->size;
+	Replace(c, page);
+	ListPush(c, T2, page);
+	return 0;
+      case B2:
+	delta = c->length[B1] > c->length[B2] ?
+	    c->length[B1] / c->length[B2] : 1;
+	c->target = c->target - delta > 0 ? c->target - delta : 0;
+	Replace(c, page);
+	ListPush(c, T2, page);
+	return 0;
+    }
+    if (c->length[T1] + c->length[B1] == c->size) {
+	if (c->length[T1] < c->size) {
+	    ListRemove(c, c->tail[B1]);
+	    Replace(c, page);
+	} else {
+	    Evict(c, c->tail[T1]);
+	    ListRemove(c, c->tail[T1]);
+	}
+    } else if (c->length[T1] + c->length[T2] + c->length[B1]
+	       + c->length[B2] >= c->size) {
+	if (c->length[T1] + c->length[T2] + c->length[B1]
+		+ c->length[B2] == 2 * c->size)
+	    ListRemove(c, c->tail[B2]);
+	Replace(c, page);
+    }
+    ListPush(c, T1, page);
+    return 0;
+}
+
+/* Refer to "page" at time "t"; return TRUE on a hit. */
+int Access(Cache *c, int page, int t)
+{
+    int f = c->frameOf[page];
+
+    if (c->policy == ARC)
+	return AccessARC(c, page);
+    if (f != -1) {
+	if (c->policy == LRU || c->policy == NACHOS)
+	    c->stamp[f] = t;
+	else if (c->policy == OPT)
+	    c->stamp[f] = nextUse[t];
+	c->use[f] = 1;
+	return 1;
+    }
+    if (c->numFree > 0)
+	f = c->freeFrames[--c->numFree];
+    else {
+	f = Victim(c, pageTid[page]);
+	Evict(c, c->framePage[f]);
+	c->frameOf[c->framePage[f]] = -1;
+    }
+    c->framePage[f] = page;
+    c->frameOf[page] = f;
+    c->stamp[f] = (c->policy == OPT) ? nextUse[t] : t;
+    c->use[f] = 1;
+    return 0;
+}
+
+/* Replay the whole trace through "c".  "tlb" is TRUE if it is a TLB. */
+void Replay(Cache *c, int tlb)
+{
+    int i, page, tid, lastTid = -1;
+
+    for (i = 0; i < numRefs; i++) {
+	if (refs[i] < 0) {
+	    Drop(c, -1 - refs[i]);
+	    continue;
+	}
+	page = refs[i] / 2;
+	tid = pageTid[page];
+	if (tlb && !c->asid && tid != lastTid)
+	    Drop(c, -1);
+	lastTid = tid;
+	if (!Access(c, page, i))
+	    c->misses++;
+	if (refs[i] & 1)
+	    c->dirty[page] = 1;
+    }
+}
+
+/* Parse a list of sizes such as "4,8,16"; return how many. */
+int ParseSizes(char *arg, int *sizes)
+{
+    int n = 0;
+    char *s;
+
+    for (s = strtok(arg, ","); s != NULL && n < MaxSizes;
+	    s = strtok(NULL, ","))
+	if (atoi(s) > 0)
+	    sizes[n++] = atoi(s);
+    return n;
+}
+
+void PrintHeading(char *what, int memory)
+{
+    int p;
+
+    printf("%s\n%8s", what, "size");
+    for (p = 0; p < NumPolicies; p++)
+	if (memory || p != NACHOS)
+	    printf("%17s", policyNames[p]);
+    printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+    TraceHeader header;
+    Cache c;
+    int tlbSizes[MaxSizes], memSizes[MaxSizes], numTLBSizes = -1;
+    int numMemSizes = -1, asid = 0, numThreads, numExits, i, p;
+    long numWrites, faults[MaxSizes][NumPolicies];
+    long writebacks[MaxSizes][NumPolicies];
+    double total;
+    char *fileName = NULL;
+
+    for (i = 1; i < argc; i++) {
+	if (!strcmp(argv[i], "-t") && i + 1 < argc)
+	    numTLBSizes = ParseSizes(argv[++i], tlbSizes);
+	else if (!strcmp(argv[i], "-m") && i + 1 < argc)
+	    numMemSizes = ParseSizes(argv[++i], memSizes);
+	else if (!strcmp(argv[i], "-asid"))
+	    asid = 1;
+	else
+	    fileName = argv[i];
+    }
+    if (fileName == NULL) {
+	fprintf(stderr, "Usage: %s [-t <TLB sizes>] [-m <memory sizes>] "
+		"[-asid] <traceFileName>\n", argv[0]);
+	fprintf(stderr, "Sizes are lists like 4,8,16, in TLB entries "
+		"and physical pages.\n");
+	exit(1);
+    }
+
+    ReadTrace(fileName, &header, &numWrites, &numThreads, &numExits);
+    FindNextUses();
+    if (numTLBSizes == -1) {		/* default to the recorded sizes */
+	numTLBSizes = header.tlbSize > 0;
+	tlbSizes[0] = header.tlbSize;
+    }
+    if (numMemSizes == -1) {
+	numMemSizes = 1;
+	memSizes[0] = header.numPhysPages;
+    }
+    total = numRefs - numExits;
+    printf("Trace %s: %d references (%ld writes) to %d pages, "
+	   "by %d threads\n", fileName, numRefs - numExits, numWrites,
+	   numPages, numThreads);
+    printf("Recorded with %d byte pages, %d physical pages, "
+	   "%d TLB entries\n\n", header.pageSize, header.numPhysPages,
+	   header.tlbSize);
+
+    if (numTLBSizes > 0) {
+	PrintHeading(asid ? "TLB misses (tagged by thread):" :
+		     "TLB misses (flushed on each thread switch):", 0);
+	for (i = 0; i < numTLBSizes; i++) {
+	    printf("%8d", tlbSizes[i]);
+	    for (p = 0; p < NACHOS; p++) {
+		Init(&c, p, tlbSizes[i], asid);
+		Replay(&c, 1);
+		printf("%10ld %5.2f%%", c.misses,
+		       total ? 100.0 * c.misses / total : 0.0);
+		Free(&c);
+	    }
+	    printf("\n");
+	}
+	printf("\n");
+    }
+
+    for (i = 0; i < numMemSizes; i++)
+	for (p = 0; p < NumPolicies; p++) {
+	    Init(&c, p, memSizes[i], 0);
+	    Replay(&c, 0);
+	    faults[i][p] = c.misses;
+	    writebacks[i][p] = c.writebacks;
+	    Free(&c);
+	}
+    PrintHeading("Page faults:", 1);
+    for (i = 0; i < numMemSizes; i++) {
+	printf("%8d", memSizes[i]);
+	for (p = 0; p < NumPolicies; p++)
+	    printf("%10ld %5.2f%%", faults[i][p],
+		   total ? 100.0 * faults[i][p] / total : 0.0);
+	printf("\n");
+    }
+    printf("\n");
+    PrintHeading("Dirty pages written back:", 1);
+    for (i = 0; i < numMemSizes; i++) {
+	printf("%8d", memSizes[i]);
+	for (p = 0; p < NumPolicies; p++)
+	    printf("%17ld", writebacks[i][p]);
+	printf("\n");
+    }
+    exit(0);
+}
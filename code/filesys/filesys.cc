@@ -359,6 +359,47 @@ FileSystem::Resize(FileHeader *fileHdr, int fileSize)
     return TRUE;
 }
 
+//----------------------------------------------------------------------
+// FileSystem::FreeSectors
+// 	Return how many sectors of the disk are free.
+//----------------------------------------------------------------------
+
+int
+FileSystem::FreeSectors()
+{
+    BitMap *freeMap = new BitMap(NumSectors);
+    int numFree;
+
+    freeMap->FetchFrom(freeMapFile);
+    numFree = freeMap->NumClear();
+    delete freeMap;
+    return numFree;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::LargestFile
+// 	Return the size of the largest file that could be created with the
+//	disk sectors that are free now.  Besides its data, a file takes a
+//	sector for its header, and, past its first FirstDirect sectors, a
+//	sector of pointers for every SecondSize sectors of data.  No file
+//	can be larger than MaxFileSize.
+//----------------------------------------------------------------------
+
+int
+FileSystem::LargestFile()
+{
+    int numFree = FreeSectors() - 1, numData;	// less the header
+
+    if (numFree <= FirstDirect)
+	numData = max(numFree, 0);
+    else {
+	numFree -= FirstDirect;
+	numData = FirstDirect + numFree / (SecondSize + 1) * SecondSize
+		  + max(numFree % (SecondSize + 1) - 1, 0);
+    }
+    return min(numData * SectorSize, (int) MaxFileSize);
+}
+
 int
 FileSystem::ReadPipe(char *data)
 {
@@ -82,6 +82,9 @@ class FileSystem {
     bool Remove(char *name);  		// Delete a file (UNIX unlink)
     
     bool Resize(FileHeader *fileHdr, int fileSize);
+    int FreeSectors();			// How many disk sectors are free
+    int LargestFile();			// Bytes in the largest file Create
+					// could make now
     
     int ReadPipe(char *data);
     int WritePipe(char *datam, int len);
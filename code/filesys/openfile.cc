@@ -100,7 +100,9 @@ OpenFile::Write(char *into, int numBytes)
 //
 //	For ReadAt:
 //	   We read in all of the full or partial sectors that are part of the
-//	   request, but we only copy the part we are interested in.
+//	   request, but we only copy the part we are interested in.  The
+//	   sectors that follow each other on the disk are read with one
+//	   request (one per track).
 //	For WriteAt:
 //	   We must first read in any sectors that will be partially written,
 //	   so that we don't overwrite the unmodified portion.  We then copy
@@ -118,7 +120,7 @@ int
 OpenFile::ReadAt(char *into, int numBytes, int position)
 {
     int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
+    int i, j, sector, firstSector, lastSector, numSectors;
     char *buf;
 
     if ((numBytes <= 0) || (position >= fileLength))
@@ -132,11 +134,17 @@ OpenFile::ReadAt(char *into, int numBytes, int position)
     lastSector = divRoundDown(position + numBytes - 1, SectorSize);
     numSectors = 1 + lastSector - firstSector;
 
-    // read in all the full and partial sectors that we need
+    // read in all the full and partial sectors that we need, each run
+    // of them that is together on the disk at once
     buf = new char[numSectors * SectorSize];
-    for (i = firstSector; i <= lastSector; i++)	
-        synchDisk->ReadSector(hdr->ByteToSector(i * SectorSize), 
+    for (i = firstSector; i <= lastSector; i = j) {
+	sector = hdr->ByteToSector(i * SectorSize);
+	for (j = i + 1; j <= lastSector
+		&& hdr->ByteToSector(j * SectorSize) == sector + j - i; j++)
+	    ;
+        synchDisk->ReadSectors(sector, j - i,
 					&buf[(i - firstSector) * SectorSize]);
+    }
 
     // copy the part we want
     bcopy(&buf[position - (firstSector * SectorSize)], into, numBytes);
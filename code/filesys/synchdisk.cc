@@ -78,6 +78,32 @@ SynchDisk::ReadSector(int sectorNumber, char* data)
     lock->Release();
 }
 
+//----------------------------------------------------------------------
+// SynchDisk::ReadSectors
+// 	Read the contents of "numSectors" disk sectors in a row into a
+//	buffer, with one request for the part of them on each track.
+//	Return only after all the data has been read.
+//
+//	"sectorNumber" -- the first disk sector to read
+//	"data" -- the buffer to hold the contents of the disk sectors
+//----------------------------------------------------------------------
+
+void
+SynchDisk::ReadSectors(int sectorNumber, int numSectors, char* data)
+{
+    int n;
+
+    lock->Acquire();			// only one disk I/O at a time
+    for (; numSectors > 0; numSectors -= n) {
+	n = min(numSectors, SectorsPerTrack - sectorNumber % SectorsPerTrack);
+	disk->ReadRequest(sectorNumber, n, data);
+	semaphore->P();			// wait for interrupt
+	sectorNumber += n;
+	data += n * SectorSize;
+    }
+    lock->Release();
+}
+
 //----------------------------------------------------------------------
 // SynchDisk::WriteSector
 // 	Write the contents of a buffer into a disk sector.  Return only
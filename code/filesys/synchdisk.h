@@ -37,6 +37,9 @@ class SynchDisk {
     					// Disk::ReadRequest/WriteRequest and
 					// then wait until the request is done.
     void WriteSector(int sectorNumber, char* data);
+    void ReadSectors(int sectorNumber, int numSectors, char* data);
+					// Read "numSectors" sectors in a
+					// row, with one request per track
     
     void RequestDone();			// Called by the disk device interrupt
 					// handler, to signal that the
@@ -0,0 +1,192 @@
+// blockcache.cc
+//	Routines to find and remember the basic blocks of user programs,
+//	so that Machine::RunBlock can run and account for a whole block
+//	at a time.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "blockcache.h"
+#include "machine.h"
+#include "mipssim.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// EndsBlock
+// 	Return how many more instructions belong to the block after
+//	"opCode": 1 for a branch or jump (its delay slot), 0 for an
+//	instruction that always traps to the kernel, -1 otherwise.
+//----------------------------------------------------------------------
+
+static int
+EndsBlock(int opCode)
+{
+    switch (opCode) {
+      case OP_BEQ:
+      case OP_BGEZ:
+      case OP_BGEZAL:
+      case OP_BGTZ:
+      case OP_BLEZ:
+      case OP_BLTZ:
+      case OP_BLTZAL:
+      case OP_BNE:
+      case OP_J:
+      case OP_JAL:
+      case OP_JALR:
+      case OP_JR:
+	return 1;
+
+      case OP_SYSCALL:
+      case OP_RES:
+      case OP_UNIMP:
+	return 0;
+
+      default:
+	return -1;
+    }
+}
+
+//----------------------------------------------------------------------
+// BlockCache::BlockCache
+// 	Initialize an empty cache of basic blocks.
+//----------------------------------------------------------------------
+
+BlockCache::BlockCache()
+{
+    table = new BasicBlock *[BlockHashSize];
+    for (int i = 0; i < BlockHashSize; i++)
+	table[i] = NULL;
+    numBlocks = 0;
+}
+
+//----------------------------------------------------------------------
+// BlockCache::~BlockCache
+// 	De-allocate the cache and every block in it.
+//----------------------------------------------------------------------
+
+BlockCache::~BlockCache()
+{
+    Flush();
+    delete [] table;
+}
+
+//----------------------------------------------------------------------
+// BlockCache::Flush
+// 	Forget every block.  Any pointer to a block the caller is still
+//	holding becomes invalid.
+//----------------------------------------------------------------------
+
+void
+BlockCache::Flush()
+{
+    BasicBlock *block, *next;
+
+    DEBUG('m', "Flushing %d basic blocks\n", numBlocks);
+    for (int i = 0; i < BlockHashSize; i++) {
+	for (block = table[i]; block != NULL; block = next) {
+	    next = block->hashNext;
+	    delete block;
+	}
+	table[i] = NULL;
+    }
+    numBlocks = 0;
+}
+
+//----------------------------------------------------------------------
+// BlockCache::Matches
+// 	Return TRUE if "block" was built from the code that is now at
+//	"pc" in address space "space" (that is, at "physAddr").
+//----------------------------------------------------------------------
+
+bool
+BlockCache::Matches(BasicBlock *block, PageTable *space, int pc,
+		    int physAddr)
+{
+    return block->pc == pc && block->space == space
+	&& block->physAddr == physAddr;
+}
+
+//----------------------------------------------------------------------
+// BlockCache::Find
+// 	Return the basic block starting at "pc".  First try the blocks
+//	that followed "from" last time, then the hash table, and only
+//	then decode a new block.  The result is chained to "from" so
+//	that the next time around it is found directly.
+//
+//	"from" -- the block that just finished executing, or NULL
+//	"space" -- the page table of the running address space
+//	"pc" -- the virtual address of the first instruction
+//	"physAddr" -- the physical address "pc" currently translates to
+//----------------------------------------------------------------------
+
+BasicBlock *
+BlockCache::Find(BasicBlock *from, PageTable *space, int pc,
+		 int physAddr)
+{
+    BasicBlock *block;
+    int bucket = ((unsigned) pc / 4) % BlockHashSize;
+
+    if (from != NULL) {
+	if (from->succ[0] != NULL && Matches(from->succ[0], space, pc, physAddr))
+	    return from->succ[0];
+	if (from->succ[1] != NULL && Matches(from->succ[1], space, pc, physAddr))
+	    return from->succ[1];
+    }
+
+    for (block = table[bucket]; block != NULL; block = block->hashNext)
+	if (Matches(block, space, pc, physAddr))
+	    break;
+
+    if (block == NULL) {
+	if (numBlocks >= MaxBlocks) {
+	    Flush();			// "from" is gone too
+	    from = NULL;
+	}
+	block = Build(space, pc, physAddr);
+	block->hashNext = table[bucket];
+	table[bucket] = block;
+	numBlocks++;
+    }
+
+    if (from != NULL) {			// chain it, replacing the older
+	from->succ[1] = from->succ[0];	// successor if need be
+	from->succ[0] = block;
+    }
+    return block;
+}
+
+//----------------------------------------------------------------------
+// BlockCache::Build
+// 	Decode forward from "pc" to find the extent of a new basic block.
+//	The block never crosses a page boundary, since the next page
+//	may not be mapped, or may be mapped somewhere else.
+//----------------------------------------------------------------------
+
+BasicBlock *
+BlockCache::Build(PageTable *space, int pc, int physAddr)
+{
+    BasicBlock *block = new BasicBlock;
+    int length = 0, left = -1;
+
+    while (length < MaxBlockLength && left != 0) {
+	Instruction *instr = machine->FetchDecoded(physAddr + length * 4);
+
+	length++;
+	if (left > 0)
+	    left--;			// that was the delay slot
+	else
+	    left = EndsBlock(instr->opCode);
+	if ((physAddr + length * 4) % PageSize == 0)
+	    break;			// end of the page
+    }
+
+    block->space = space;
+    block->pc = pc;
+    block->physAddr = physAddr;
+    block->length = length;
+    block->succ[0] = block->succ[1] = NULL;
+    DEBUG('m', "New basic block at 0x%x, %d instructions\n", pc, length);
+    return block;
+}
@@ -0,0 +1,71 @@
+// blockcache.h
+//	Data structures for running user programs a basic block at a time.
+//
+//	A basic block is a run of straight-line MIPS code: it ends with a
+//	branch or jump (plus its delay slot), a syscall, an illegal
+//	instruction, or the end of the page it starts in.  Once found,
+//	blocks are remembered, keyed by address space and starting PC,
+//	and each block remembers the blocks control went to when it
+//	finished, so that loops rarely need to search the cache.
+//
+//	Blocks only record *where* the code is.  The instructions are
+//	still fetched (and translated) one at a time when the block runs,
+//	so a stale block can never execute the wrong code -- at worst it
+//	stops early.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef BLOCKCACHE_H
+#define BLOCKCACHE_H
+
+#include "copyright.h"
+#include "utility.h"
+#include "translate.h"
+#include "pagetable.h"
+
+#define MaxBlockLength	64	// longest block we will build
+#define BlockHashSize	256	// buckets in the block cache
+#define MaxBlocks	2048	// flush the cache when it holds more
+
+// The following class defines a basic block found in a user program.
+
+class BasicBlock {
+  public:
+    PageTable *space;	// page table of the address space the
+				// block was found in
+    int pc;			// virtual address of its first instruction
+    int physAddr;		// where that instruction was in mainMemory
+    int length;			// number of instructions in the block
+
+    BasicBlock *succ[2];	// blocks that followed this one, if any
+    BasicBlock *hashNext;	// next block in the same hash bucket
+};
+
+// The following class defines the cache of basic blocks used by
+// Machine::RunBlock.
+
+class BlockCache {
+  public:
+    BlockCache();			// Initialize an empty cache
+    ~BlockCache();			// De-allocate all the blocks
+
+    BasicBlock *Find(BasicBlock *from, PageTable *space, int pc,
+		     int physAddr);	// Return the block at "pc", building
+					// it if necessary.  "from" is the
+					// block that just finished, if any.
+    void Flush();			// Forget all blocks
+
+  private:
+    BasicBlock *Build(PageTable *space, int pc, int physAddr);
+					// Decode forward from "pc" to find
+					// the end of a new block
+    bool Matches(BasicBlock *block, PageTable *space, int pc,
+		 int physAddr);		// Is "block" the one at "pc"?
+
+    BasicBlock **table;			// hash table, indexed by pc
+    int numBlocks;			// number of blocks in the table
+};
+
+#endif // BLOCKCACHE_H
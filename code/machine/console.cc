@@ -93,11 +93,20 @@ Console::CheckCharAvail()
 			ConsoleReadInt);
 
     // do nothing if character is already buffered, or none to be read
-    if ((incoming != EOF) || !PollFile(readFileNo))
-	return;	  
-
-    // otherwise, read character and tell user about it
-    Read(readFileNo, &c, sizeof(char));
+    if (incoming != EOF)
+	return;
+    if (inputLog != NULL && inputLog->Replaying()) {
+	if (!inputLog->Replay(ConsoleCharInput, &c, sizeof(char)))
+	    return;
+    } else {
+	if (!PollFile(readFileNo))
+	    return;
+	Read(readFileNo, &c, sizeof(char));
+	if (inputLog != NULL)
+	    inputLog->Record(ConsoleCharInput, &c, sizeof(char));
+    }
+
+    // otherwise, tell user about the character
     incoming = c ;
     stats->numConsoleCharsRead++;
     (*readHandler)(handlerArg);	
@@ -0,0 +1,237 @@
+// cpu.cc
+//	Routines to run the CPUs of a multiprocessor on host threads of
+//	their own, and the lock that keeps them out of each other's way
+//	in the kernel.
+//
+//	Only compiled in when HOST_THREADS is defined (see Makefile.common).
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+
+#ifdef HOST_THREADS
+
+//----------------------------------------------------------------------
+// SaveInterruptState, RestoreInterruptState
+// 	Remember the interrupt level and status of "cpu" when it leaves
+//	the kernel, and put them back when it comes back in.
+//----------------------------------------------------------------------
+
+static void
+SaveInterruptState(CPU *cpu)
+{
+    cpu->level = interrupt->getLevel();
+    cpu->status = interrupt->getStatus();
+    cpu->inKernel = FALSE;
+}
+
+static void
+RestoreInterruptState(CPU *cpu)
+{
+    cpu->inKernel = TRUE;
+    interrupt->RestoreLevel(cpu->level);
+    interrupt->setStatus(cpu->status);
+}
+
+//----------------------------------------------------------------------
+// KernelLock::KernelLock
+// 	Initialize the kernel lock.  The current CPU, which is starting
+//	up Nachos, holds it to begin with.
+//
+//	"order" -- if TRUE, grant the lock to the CPUs in turn
+//----------------------------------------------------------------------
+
+KernelLock::KernelLock(bool order)
+{
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&changed, NULL);
+    inOrder = order;
+    turn = currentCPU->id;
+    for (int i = 0; i < MaxCPUs; i++)
+	waiting[i] = FALSE;
+    currentCPU->inKernel = TRUE;
+    if (numCPUs > 1)
+	pthread_mutex_lock(&mutex);
+}
+
+//----------------------------------------------------------------------
+// KernelLock::~KernelLock
+// 	De-allocate the kernel lock.
+//----------------------------------------------------------------------
+
+KernelLock::~KernelLock()
+{
+    pthread_mutex_destroy(&mutex);
+    pthread_cond_destroy(&changed);
+}
+
+//----------------------------------------------------------------------
+// KernelLock::Acquire
+// 	Wait until no other CPU is in the kernel (and, with inOrder, until
+//	it is this CPU's turn), then enter it.  Does nothing if there is
+//	only one CPU.
+//----------------------------------------------------------------------
+
+void
+KernelLock::Acquire()
+{
+    CPU *cpu = currentCPU;
+
+    if (numCPUs == 1)
+	return;
+    ASSERT(!cpu->inKernel);
+    cpu->inUserCode = FALSE;		// done with user memory, for now
+    pthread_mutex_lock(&mutex);
+    while (inOrder && turn != cpu->id)
+	pthread_cond_wait(&changed, &mutex);
+    RestoreInterruptState(cpu);
+}
+
+//----------------------------------------------------------------------
+// KernelLock::Release
+// 	Leave the kernel, so that another CPU may enter it.  Does nothing
+//	if there is only one CPU.
+//----------------------------------------------------------------------
+
+void
+KernelLock::Release()
+{
+    CPU *cpu = currentCPU;
+
+    if (numCPUs == 1)
+	return;
+    ASSERT(cpu->inKernel);
+    SaveInterruptState(cpu);
+    cpu->inUserCode = TRUE;
+    if (inOrder) {
+	PassTurn(cpu->id);
+	pthread_cond_broadcast(&changed);
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+//----------------------------------------------------------------------
+// KernelLock::Wait
+// 	Leave the kernel until another CPU calls Wake for this one, then
+//	come back in.  The caller's host thread sleeps meanwhile; with
+//	inOrder, this CPU is skipped when handing out turns.
+//----------------------------------------------------------------------
+
+void
+KernelLock::Wait()
+{
+    CPU *cpu = currentCPU;
+
+    ASSERT(cpu->inKernel);
+    SaveInterruptState(cpu);
+    waiting[cpu->id] = TRUE;
+    if (inOrder) {
+	PassTurn(cpu->id);
+	pthread_cond_broadcast(&changed);
+    }
+    while (waiting[cpu->id] || (inOrder && turn != cpu->id))
+	pthread_cond_wait(&changed, &mutex);
+    RestoreInterruptState(cpu);
+}
+
+//----------------------------------------------------------------------
+// KernelLock::Wake
+// 	Let CPU "which", which is in Wait, compete for the kernel again.
+//	Called with the lock held.
+//----------------------------------------------------------------------
+
+void
+KernelLock::Wake(int which)
+{
+    waiting[which] = FALSE;
+    pthread_cond_broadcast(&changed);
+}
+
+//----------------------------------------------------------------------
+// KernelLock::PassTurn
+// 	With inOrder, give the next turn to the first CPU after "from"
+//	(perhaps "from" itself) that is not in Wait.  Called with the
+//	lock held.
+//----------------------------------------------------------------------
+
+void
+KernelLock::PassTurn(int from)
+{
+    for (int i = 1; i <= numCPUs; i++)
+	if (!waiting[(from + i) % numCPUs]) {
+	    turn = (from + i) % numCPUs;
+	    return;
+	}
+}
+
+//----------------------------------------------------------------------
+// CPURoot
+// 	The first routine run by the host thread of each CPU but the
+//	first.  Makes a Thread to stand for the host thread's own stack,
+//	and has it finish at once: Thread::Sleep then waits for something
+//	for the CPU to run.
+//
+//	"arg" -- the CPU
+//----------------------------------------------------------------------
+
+static char cpuNames[MaxCPUs][8];
+
+static void *
+CPURoot(void *arg)
+{
+    CPU *cpu = (CPU *) arg;
+
+    cpu->host = pthread_self();		// from now on, we are currentCPU
+    kernelLock->Acquire();
+    sprintf(cpuNames[cpu->id], "cpu %d", cpu->id);
+    currentThread = Thread::GenThread(cpuNames[cpu->id]);
+    currentThread->setStatus(RUNNING);
+    cpu->thread = currentThread;
+    currentThread->Finish();		// never returns
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// StartCPUs
+// 	Give each CPU but the first a Machine of its own, sharing memory
+//	with the first one's, and start its host thread.  Called once,
+//	by Initialize, holding the kernel lock.
+//
+//	"debug" -- if TRUE, single step user programs
+//----------------------------------------------------------------------
+
+void
+StartCPUs(bool debug)
+{
+    pthread_t host;
+
+    for (int i = 1; i < numCPUs; i++) {
+	cpus[i]->cpuMachine = new Machine(debug, machine);
+	if (pthread_create(&host, NULL, CPURoot, (void *) cpus[i]))
+	    ASSERT(FALSE);
+    }
+}
+
+//----------------------------------------------------------------------
+// CurrentCPU
+// 	Return the CPU whose host thread we are on.  Looked up on every
+//	call, and never inline: after a context switch, the caller may
+//	be on another host thread than before (see cpu.h).
+//----------------------------------------------------------------------
+
+CPU *
+CurrentCPU()
+{
+    pthread_t self = pthread_self();
+
+    for (int i = 0; i < numCPUs; i++)
+	if (pthread_equal(cpus[i]->host, self))
+	    return cpus[i];
+    ASSERT(FALSE);			// not a host thread of ours
+    return NULL;
+}
+
+#endif // HOST_THREADS
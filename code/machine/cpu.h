@@ -0,0 +1,141 @@
+// cpu.h
+//	Data structures describing the processors of a multi-CPU
+//	(SMP) Nachos machine.
+//
+//	All the CPUs share main memory and the interrupt controller.
+//	Each one has its own TLB (see Machine::SetCPU), its own current
+//	thread, and its own ready list (see Scheduler).  Its registers
+//	are in machine->registers while it is being simulated, and in
+//	its thread's userRegisters the rest of the time.
+//
+//	Each CPU keeps a clock of its own; the machine's clock
+//	(stats->totalTicks) is the latest time any of them has reached.
+//
+//	The CPUs are simulated one at a time, in rounds: each busy CPU
+//	in turn runs for CPUQuantum ticks, starting from the time the
+//	round began, and the next round starts at the latest time any
+//	of them reached.  The order is fixed, so that a run is exactly
+//	repeatable; see Scheduler::NextCPU.
+//
+//	With HOST_THREADS, the CPUs instead really run at the same time,
+//	each on a host thread of its own, with a Machine of its own
+//	(sharing mainMemory with the others).  Each still keeps its own
+//	clock; one that has been idle catches up with the machine's clock
+//	when it is given work again.  The kernel is protected by
+//	a single lock, held whenever a CPU is not running user code; see
+//	KernelLock below.
+//
+//	With one CPU (the default), none of this changes anything.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef CPU_H
+#define CPU_H
+
+#include "copyright.h"
+#include "utility.h"
+#include "interrupt.h"
+
+#ifdef HOST_THREADS
+#include <pthread.h>
+#endif
+
+#define MaxCPUs		8	// most CPUs "-ncpu" will give us
+#define CPUQuantum	100	// ticks each CPU runs for in a round
+
+// Variables with one copy per CPU: currentThread, threadToBeDestroyed
+// and machine (see system.h).  When the CPUs are simulated one at a
+// time, these are ordinary variables, which the scheduler switches
+// along with currentCPU.  When the CPUs run on host threads, they are
+// fields of the CPU whose host thread we are on, which CurrentCPU finds
+// afresh every time one of them is used.  (A Nachos thread can move
+// from one host thread to another inside SWITCH, so nothing that
+// depends on the host thread may be kept across a context switch.)
+
+class Thread;
+class Machine;
+
+// The following class defines one simulated CPU.
+
+class CPU {
+  public:
+    CPU(int which) { id = which; thread = NULL; clock = 0;
+		     sliceEnd = CPUQuantum;
+#ifdef HOST_THREADS
+		     current = toBeDestroyed = NULL; cpuMachine = NULL;
+		     sleeper = NULL; inKernel = FALSE;
+		     inUserCode = FALSE;
+		     level = IntOn; status = SystemMode;
+#endif
+		   }
+
+    int id;			// which CPU this is
+    Thread *thread;		// thread running on it; NULL if it is idle
+    int clock;			// time it has reached
+    int sliceEnd;		// time its current turn is over
+
+#ifdef HOST_THREADS
+    Thread *current;		// its currentThread; unlike "thread", still
+				// set while it waits for work
+    Thread *toBeDestroyed;	// its threadToBeDestroyed
+    Machine *cpuMachine;	// its machine: registers, TLB, etc.
+    Thread *sleeper;		// thread waiting on this host thread for
+				// something to run, if the CPU is idle
+    bool inKernel;		// does it hold the kernel lock?
+    bool inUserCode;		// is it running user code (between
+				// Release and Acquire)?
+    IntStatus level;		// interrupt level and status while it is
+    MachineStatus status;	// not holding the kernel lock
+    pthread_t host;		// the host thread it runs on
+#endif
+};
+
+#ifdef HOST_THREADS
+// The following class defines the lock that protects the whole Nachos
+// kernel when the CPUs run on host threads.  Holding it stands in for
+// having interrupts disabled on a uniprocessor: all the existing
+// IntOff critical sections stay correct, since only one CPU at a time
+// is ever in the kernel.  A CPU gives it up only while it runs user
+// code (Machine::RunBurst) or waits for work (Scheduler::WaitForWork).
+//
+// The interrupt level and status are saved and restored with the
+// lock, so that each CPU sees its own.
+//
+// If "inOrder" is set (-lockstep), the CPUs get the lock strictly in
+// turn, by CPU number, skipping idle ones; and each runs at most
+// CPUQuantum ticks of user code at a time.  So everything the kernel
+// does happens in the same order on every run.
+
+class KernelLock {
+  public:
+    KernelLock(bool inOrder);		// Initialize the lock, held by
+					// the current CPU
+    ~KernelLock();			// De-allocate the lock
+
+    void Acquire();			// Enter the kernel on this CPU
+    void Release();			// Leave it, to run user code
+    void Wait();			// Give up the lock until Wake is
+					// called for this CPU
+    void Wake(int which);		// Let CPU "which" back in
+    bool InOrder() { return inOrder; }
+
+  private:
+    void PassTurn(int from);		// With inOrder, let the next CPU in
+
+    pthread_mutex_t mutex;		// held by the CPU in the kernel
+    pthread_cond_t changed;		// broadcast when "turn" or "waiting"
+					// changes
+    bool inOrder;			// grant the lock in CPU order?
+    int turn;				// if so, the CPU that may have it
+    bool waiting[MaxCPUs];		// CPUs in Wait, not yet woken
+};
+
+extern void StartCPUs(bool debug);	// Start the host threads of the
+					// other CPUs
+extern CPU *CurrentCPU();		// The CPU whose host thread we
+					// are on
+#endif // HOST_THREADS
+
+#endif // CPU_H
@@ -115,19 +115,40 @@ PrintSector (bool writing, int sector, char *data)
 void
 Disk::ReadRequest(int sectorNumber, char* data)
 {
-    int ticks = ComputeLatency(sectorNumber, FALSE);
+    ReadRequest(sectorNumber, 1, data);
+}
+
+//----------------------------------------------------------------------
+// Disk::ReadRequest
+// 	Simulate a request to read "numSectors" sectors in a row, from
+//	"sectorNumber" on, all on the same track.  Once the first sector
+//	has been reached, the rest pass under the head one after the
+//	other, so each only adds the time to transfer it.
+//----------------------------------------------------------------------
+
+void
+Disk::ReadRequest(int sectorNumber, int numSectors, char* data)
+{
+    int ticks = ComputeLatency(sectorNumber, FALSE)
+		+ (numSectors - 1) * RotationTime;
 
     ASSERT(!active);				// only one request at a time
-    ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
+    ASSERT((sectorNumber >= 0) && (numSectors >= 1)
+	   && (sectorNumber + numSectors <= NumSectors));
+    ASSERT(sectorNumber / SectorsPerTrack
+	   == (sectorNumber + numSectors - 1) / SectorsPerTrack);
     
-    DEBUG('d', "Reading from sector %d\n", sectorNumber);
+    DEBUG('d', "Reading from sectors %d to %d\n", sectorNumber,
+	  sectorNumber + numSectors - 1);
     Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
-    Read(fileno, data, SectorSize);
+    Read(fileno, data, numSectors * SectorSize);
     if (DebugIsEnabled('d'))
-	PrintSector(FALSE, sectorNumber, data);
+	for (int i = 0; i < numSectors; i++)
+	    PrintSector(FALSE, sectorNumber + i, &data[i * SectorSize]);
     
     active = TRUE;
     UpdateLast(sectorNumber);
+    lastSector = sectorNumber + numSectors - 1;
     stats->numDiskReads++;
     interrupt->Schedule(DiskDone, (int) this, ticks, DiskInt);
 }
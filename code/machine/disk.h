@@ -66,6 +66,10 @@ class Disk {
     					// the disk and return immediately.
     					// Only one request allowed at a time!
     void WriteRequest(int sectorNumber, char* data);
+    void ReadRequest(int sectorNumber, int numSectors, char* data);
+					// Read "numSectors" sectors in a
+					// row, all on one track, with one
+					// request
 
     void HandleInterrupt();		// Interrupt handler, invoked when
 					// disk request finishes.
@@ -0,0 +1,204 @@
+// inputlog.cc
+//	Routines to record the inputs from the host, and to replay them,
+//	in the format described in inputlog.h.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "inputlog.h"
+#include "system.h"
+#include "sysdep.h"
+
+static char *kindNames[] = { "random number", "console character",
+			     "network packet", "console read" };
+
+//----------------------------------------------------------------------
+// InputLog::InputLog
+// 	Create the log file and write its magic number, or read in the
+//	whole of a log to replay.
+//
+//	"name" -- the log file
+//	"replay" -- TRUE to replay the log, FALSE to record it
+//----------------------------------------------------------------------
+
+InputLog::InputLog(char *name, bool replay)
+{
+    int magic;
+
+    fileName = name;
+    replaying = replay;
+    if (replaying) {
+	file = OpenForReadWrite(name, TRUE);
+	Lseek(file, 0, 2);
+	numBuffered = Tell(file);
+	Lseek(file, 0, 0);
+	buffer = new char[numBuffered];
+	Read(file, buffer, numBuffered);
+	Close(file);
+	bcopy(buffer, (char *) &magic, sizeof(magic));
+	ASSERT(numBuffered >= (int) sizeof(magic) && magic == InputLogMagic);
+	position = sizeof(magic);
+    } else {
+	file = OpenForWrite(name);
+	buffer = new char[InputBufferSize];
+	numBuffered = 0;
+	magic = InputLogMagic;
+	Write((char *) &magic, sizeof(magic));
+    }
+}
+
+//----------------------------------------------------------------------
+// InputLog::~InputLog
+// 	Write out whatever is still buffered, and close the log.  When
+//	replaying, say if the run ended before the log did.
+//----------------------------------------------------------------------
+
+InputLog::~InputLog()
+{
+    if (replaying) {
+	if (position < numBuffered)
+	    printf("Replay of %s ended with %d bytes of input left.\n",
+		   fileName, numBuffered - position);
+    } else {
+	Flush();
+	Close(file);
+    }
+    delete [] buffer;
+}
+
+//----------------------------------------------------------------------
+// InputLog::Record
+// 	Log an input that has just arrived from the host.
+//
+//	"kind" -- what sort of input it is
+//	"data" -- the input itself
+//	"length" -- how many bytes of it there are
+//----------------------------------------------------------------------
+
+void
+InputLog::Record(InputKind kind, char *data, int length)
+{
+    InputRecord record;
+
+    ASSERT(!replaying);
+    record.when = stats->totalTicks;
+    record.kind = kind;
+    record.length = length;
+    Write((char *) &record, sizeof(record));
+    Write(data, length);
+}
+
+//----------------------------------------------------------------------
+// InputLog::Replay
+// 	Take the next input from the log, in place of asking the host for
+//	one.  Device polls have nothing to read unless the next input is
+//	theirs, and was recorded at this very time.
+//
+//	Returns TRUE if "data" has been filled in.
+//
+//	"kind" -- the sort of input wanted
+//	"data" -- where to put it
+//	"length" -- how many bytes of it there should be
+//----------------------------------------------------------------------
+
+bool
+InputLog::Replay(InputKind kind, char *data, int length)
+{
+    InputRecord record;
+
+    ASSERT(replaying);
+    if (position == numBuffered)
+	return FALSE;			// the recorded run ended here
+    bcopy(buffer + position, (char *) &record, sizeof(record));
+    if (record.when < stats->totalTicks)
+	Diverged(kind);			// it should have been taken already
+    if (record.when > stats->totalTicks || record.kind != kind)
+	return FALSE;
+    if (record.length != length)
+	Diverged(kind);
+    bcopy(buffer + position + sizeof(record), data, length);
+    position += sizeof(record) + length;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// InputLog::Expect
+// 	Replay an input that the recorded run must have got at this
+//	point -- one the program waits for, rather than polls for.
+//----------------------------------------------------------------------
+
+void
+InputLog::Expect(InputKind kind, char *data, int length)
+{
+    if (!Replay(kind, data, length))
+	Diverged(kind);
+}
+
+//----------------------------------------------------------------------
+// InputLog::Random
+// 	Return a pseudo-random number: the next one from the host, or the
+//	one the recorded run got at this point.
+//----------------------------------------------------------------------
+
+int
+InputLog::Random()
+{
+    int value;
+
+    if (replaying)
+	Expect(RandomInput, (char *) &value, sizeof(value));
+    else {
+	value = ::Random();
+	Record(RandomInput, (char *) &value, sizeof(value));
+    }
+    return value;
+}
+
+//----------------------------------------------------------------------
+// InputLog::Write
+// 	Add bytes to the buffer, writing the buffer out as it fills.
+//----------------------------------------------------------------------
+
+void
+InputLog::Write(char *data, int length)
+{
+    while (length > 0) {
+	int n = min(length, InputBufferSize - numBuffered);
+
+	bcopy(data, buffer + numBuffered, n);
+	numBuffered += n;
+	data += n;
+	length -= n;
+	if (numBuffered == InputBufferSize)
+	    Flush();
+    }
+}
+
+//----------------------------------------------------------------------
+// InputLog::Flush
+// 	Write out the buffered records.
+//----------------------------------------------------------------------
+
+void
+InputLog::Flush()
+{
+    WriteFile(file, buffer, numBuffered);
+    numBuffered = 0;
+}
+
+//----------------------------------------------------------------------
+// InputLog::Diverged
+// 	The run being replayed wanted an input the recorded run didn't
+//	get at this point -- it was given different flags, or a
+//	different program.  Nothing that follows can be trusted, so stop.
+//----------------------------------------------------------------------
+
+void
+InputLog::Diverged(InputKind kind)
+{
+    printf("Replay of %s diverged at time %d, asking for a %s.\n",
+	   fileName, stats->totalTicks, kindNames[kind]);
+    Exit(1);
+}
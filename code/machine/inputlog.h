@@ -0,0 +1,87 @@
+// inputlog.h
+//	Data structures for recording the inputs that make one Nachos run
+//	differ from the next, and for feeding them back in.
+//
+//	With -record, every such input is logged, along with the
+//	simulated time it arrived at:
+//
+//		each pseudo-random number (the -rs timer, lost packets)
+//		each character the console reads in
+//		each packet the network reads in
+//		the characters a user program reads from ConsoleInput
+//
+//	With -replay, none of these come from the host; each is taken
+//	from the log instead, at the time it was recorded.  Given the same
+//	program and the same flags, the run then repeats exactly, thread
+//	switch for thread switch -- for instance to compare a change to
+//	the scheduler or the VM system on the same interleaving.  If the
+//	run asks for an input other than the one logged next, it has
+//	diverged from the recorded run, and Nachos stops.
+//
+//	The log is a binary file, in host byte order: the magic number,
+//	then each input as an InputRecord, followed by its "length" bytes.
+//	With HOST_THREADS, the order of the inputs is only repeatable
+//	along with -lockstep.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef INPUTLOG_H
+#define INPUTLOG_H
+
+#include "copyright.h"
+#include "utility.h"
+
+#define InputLogMagic	0x4e494e50	// "NINP"
+#define InputBufferSize	8192		// bytes buffered before writing
+
+// The kinds of input that are logged.
+
+enum InputKind { RandomInput, ConsoleCharInput, PacketInput, ReadInput };
+
+// How each input starts in the log.
+
+typedef struct {
+    int when;				// stats->totalTicks when it arrived
+    int kind;				// an InputKind
+    int length;				// how many bytes of it follow
+} InputRecord;
+
+// The following class defines a log being recorded, or replayed.
+
+class InputLog {
+  public:
+    InputLog(char *name, bool replay);	// Record to file "name", or
+					// replay from it
+    ~InputLog();			// Flush the log and close it
+
+    bool Replaying() { return replaying; }
+
+    void Record(InputKind kind, char *data, int length);
+					// An input has arrived from the host
+    bool Replay(InputKind kind, char *data, int length);
+					// Copy the next input into "data",
+					// if it is of this kind and it
+					// arrived at this time
+    void Expect(InputKind kind, char *data, int length);
+					// Replay an input that must come
+					// next, or stop
+    int Random();			// Random(), recorded or replayed
+
+  private:
+    void Write(char *data, int length);	// Buffer part of a record
+    void Flush();			// Write out the buffered records
+    void Diverged(InputKind kind);	// The run no longer matches the log
+
+    char *fileName;			// the log
+    bool replaying;			// TRUE if inputs come from the log
+    int file;				// where the log goes, when recording
+    char *buffer;			// records not yet written, when
+					// recording; the whole log, when
+					// replaying
+    int numBuffered;			// bytes in buffer
+    int position;			// where the next input to replay is
+};
+
+#endif // INPUTLOG_H
@@ -61,6 +61,7 @@ Interrupt::Interrupt()
 {
     level = IntOff;
     pending = new List();
+    nextDue = NothingDue;
     inHandler = FALSE;
     yieldOnReturn = FALSE;
     status = SystemMode;
@@ -146,22 +147,42 @@ Interrupt::Enable()
 //	Two things can cause OneTick to be called:
 //		interrupts are re-enabled
 //		a user instruction is executed
+//
+//	The simulator may also account for a whole run of user 
+//	instructions at once, provided none of them would have seen
+//	an interrupt (see TicksUntilDue).
+//
+//	Most of the time nothing is due yet, and there is nothing to do
+//	but advance the clock.
+//
+//	On a multiprocessor, it is the current CPU's clock that advances;
+//	the machine's clock only moves on once that gets ahead of it.
+//
+//	"ticks" -- how many instructions or kernel steps to account for
 //----------------------------------------------------------------------
 void
-Interrupt::OneTick()
+Interrupt::OneTick(int ticks)
 {
     MachineStatus old = status;
 
 // advance simulated time
     if (status == SystemMode) {
-        stats->totalTicks += SystemTick;
-	stats->systemTicks += SystemTick;
+        currentCPU->clock += SystemTick * ticks;
+	stats->systemTicks += SystemTick * ticks;
     } else {					// USER_PROGRAM
-	stats->totalTicks += UserTick;
-	stats->userTicks += UserTick;
+	currentCPU->clock += UserTick * ticks;
+	stats->userTicks += UserTick * ticks;
     }
+    if (currentCPU->clock > stats->totalTicks)
+	stats->totalTicks = currentCPU->clock;
     DEBUG('i', "\n== Tick %d ==\n", stats->totalTicks);
 
+    if (stats->totalTicks < nextDue && !yieldOnReturn
+		&& !DebugIsEnabled('i')) {
+	level = IntOn;			// same as below, but no handler
+	return;				// can possibly be due
+    }
+
 // check any pending interrupts are now ready to fire
     ChangeLevel(IntOn, IntOff);		// first, turn off interrupts
 					// (interrupt handlers run with
@@ -173,11 +194,109 @@ Interrupt::OneTick()
 					// for a context switch, ok to do it now
 	yieldOnReturn = FALSE;
  	status = SystemMode;		// yield is a kernel routine
+#ifdef USER_PROGRAM
+	if (old == UserMode) {		// switched out between instructions
+	    if (checkpoint != NULL && checkpoint->TimeSlice()) {
+		delete checkpoint;
+		checkpoint = NULL;
+	    }
+	    currentThread->restartable = TRUE;
+	}
+#endif
 	currentThread->Yield();
+#ifdef USER_PROGRAM
+	currentThread->restartable = FALSE;
+#endif
 	status = old;
     }
 }
 
+//----------------------------------------------------------------------
+// Interrupt::TicksUntilDue
+// 	Return how many ticks of simulated time can pass before the
+//	earliest pending interrupt is due.  A run of that many user
+//	instructions can be accounted for with a single OneTick, because
+//	no interrupt could have fired in the middle of it.
+//----------------------------------------------------------------------
+
+int
+Interrupt::TicksUntilDue()
+{
+    return nextDue - stats->totalTicks;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::OnlyPending
+// 	Return TRUE if exactly one interrupt is pending, and it is of kind
+//	"type", as when the timer is the only device busy.  Used to find
+//	a moment when all the hardware state can be written to a
+//	checkpoint.
+//
+//	"type" -- the kind of interrupt allowed to be pending
+//	"when" -- where to store the time the interrupt is due
+//----------------------------------------------------------------------
+
+static int numPending;			// for OnlyPending
+
+static void
+CountPending(int arg)
+{
+    numPending++;
+}
+
+bool
+Interrupt::OnlyPending(IntType type, int *when)
+{
+    PendingInterrupt *first = (PendingInterrupt *) pending->SortedFirst(when);
+
+    if (first == NULL || first->type != type)
+	return FALSE;
+    numPending = 0;
+    pending->Mapcar(CountPending);
+    return numPending == 1;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Reschedule
+// 	Change when the pending interrupts of kind "type" are due, as when
+//	restoring the timer from a checkpoint.  Interrupts due at the
+//	same time stay in the order they were scheduled.
+//
+//	"type" -- the kind of interrupt to move
+//	"when" -- the (absolute) time it is now due
+//----------------------------------------------------------------------
+
+void
+Interrupt::Reschedule(IntType type, int when)
+{
+    List *sorted = new List();
+    PendingInterrupt *toOccur;
+    int key;
+
+    while ((toOccur = (PendingInterrupt *) pending->SortedRemove(&key))
+	    != NULL) {
+	if (toOccur->type == type)
+	    toOccur->when = when;
+	sorted->SortedInsert(toOccur, toOccur->when);
+    }
+    delete pending;
+    pending = sorted;
+    UpdateNextDue();
+}
+
+//----------------------------------------------------------------------
+// Interrupt::UpdateNextDue
+// 	Remember when the first pending interrupt is due, after the
+//	pending list has changed.
+//----------------------------------------------------------------------
+
+void
+Interrupt::UpdateNextDue()
+{
+    if (pending->SortedFirst(&nextDue) == NULL)
+	nextDue = NothingDue;
+}
+
 //----------------------------------------------------------------------
 // Interrupt::YieldOnReturn
 // 	Called from within an interrupt handler, to cause a context switch
@@ -272,6 +391,7 @@ Interrupt::Schedule(VoidFunctionPtr handler, int arg, int fromNow, IntType type)
     ASSERT(fromNow > 0);
 
     pending->SortedInsert(toOccur, when);
+    UpdateNextDue();
 }
 
 //----------------------------------------------------------------------
@@ -298,7 +418,7 @@ Interrupt::CheckIfDue(bool advanceClock)
     if (DebugIsEnabled('i'))
 	DumpState();
     PendingInterrupt *toOccur = 
-		(PendingInterrupt *)pending->SortedRemove(&when);
+		(PendingInterrupt *)pending->SortedFirst(&when);
 
     if (toOccur == NULL)		// no pending interrupts
 	return FALSE;			
@@ -306,10 +426,11 @@ Interrupt::CheckIfDue(bool advanceClock)
     if (advanceClock && when > stats->totalTicks) {	// advance the clock
 	stats->idleTicks += (when - stats->totalTicks);
 	stats->totalTicks = when;
-    } else if (when > stats->totalTicks) {	// not time yet, put it back
-	pending->SortedInsert(toOccur, when);
-	return FALSE;
-    }
+	currentCPU->clock = when;
+    } else if (when > stats->totalTicks)	// not time yet, leave it
+	return FALSE;			// (interrupts due at the same time
+					// stay in the order scheduled)
+    (void) pending->SortedRemove(&when);
 
 // Check if there is nothing more to do, and if so, quit
     if ((status == IdleMode) && (toOccur->type == TimerInt) 
@@ -317,6 +438,7 @@ Interrupt::CheckIfDue(bool advanceClock)
 	 pending->SortedInsert(toOccur, when);
 	 return FALSE;
     }
+    UpdateNextDue();
 
     DEBUG('i', "Invoking interrupt handler for the %s at time %d\n", 
 			intTypeNames[toOccur->type], toOccur->when);
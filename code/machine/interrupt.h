@@ -52,6 +52,9 @@ enum MachineStatus {IdleMode, SystemMode, UserMode};
 enum IntType { TimerInt, DiskInt, ConsoleWriteInt, ConsoleReadInt, 
 				ElevatorInt, NetworkSendInt, NetworkRecvInt};
 
+// TicksUntilDue is this far off when no interrupt is pending.
+#define NothingDue	0x7fffffff
+
 // The following class defines an interrupt that is scheduled
 // to occur in the future.  The internal data structures are
 // left public to make it simpler to manipulate.
@@ -97,6 +100,11 @@ class Interrupt {
 
     MachineStatus getStatus() { return status; } // idle, kernel, user
     void setStatus(MachineStatus st) { status = st; }
+#ifdef HOST_THREADS
+    void RestoreLevel(IntStatus old) { level = old; }
+					// Set the level without advancing
+					// the time; for KernelLock
+#endif
 
     void DumpState();			// Print interrupt state
     
@@ -110,12 +118,23 @@ class Interrupt {
 	int arg, int when, IntType type);// at time ``when''.  This is called
     					// by the hardware device simulators.
     
-    void OneTick();       		// Advance simulated time
+    void OneTick(int ticks = 1);	// Advance simulated time by "ticks"
+					// instructions or kernel steps
+    int TicksUntilDue();		// How long before the next pending 
+					// interrupt is due
+    bool OnlyPending(IntType type, int *when);
+					// Is the one pending interrupt of
+					// kind "type"?  If so, when is it due?
+    void Reschedule(IntType type, int when);
+					// Make the pending interrupts of
+					// kind "type" due at "when"
 
   private:
     IntStatus level;		// are interrupts enabled or disabled?
     List *pending;		// the list of interrupts scheduled
 				// to occur in the future
+    int nextDue;		// when the first of them is due, or
+				// NothingDue
     bool inHandler;		// TRUE if we are running an interrupt handler
     bool yieldOnReturn; 	// TRUE if we are to context switch
 				// on return from the interrupt handler
@@ -125,6 +144,7 @@ class Interrupt {
 
     bool CheckIfDue(bool advanceClock); // Check if an interrupt is supposed
 					// to occur now
+    void UpdateNextDue();		// Recompute nextDue
 
     void ChangeLevel(IntStatus old, 	// SetLevel, without advancing the
 	IntStatus now);  		// simulated time
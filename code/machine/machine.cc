@@ -11,6 +11,14 @@
 #include "machine.h"
 #include "system.h"
 
+// The size of the machine, set by Initialize from the command line.
+int PageSize = DefaultPageSize;
+int NumPhysPages = DefaultNumPhysPages;
+int TLBSize = DefaultTLBSize;
+int TLBWays = 0;
+
+int Machine::lruClock = 0;		// shared by the Machines of all CPUs
+
 // Textual names of the exceptions that can be generated by user program
 // execution, for debugging.
 static char* exceptionNames[] = { "no exception", "syscall", 
@@ -50,30 +58,52 @@ void CheckEndian()
 //
 //	"debug" -- if TRUE, drop into the debugger after each user instruction
 //		is executed.
+//	"shared" -- if not NULL, the Machine of another CPU, whose memory
+//		this one is to share (each CPU still decodes instructions
+//		into a cache of its own)
 //----------------------------------------------------------------------
 
-Machine::Machine(bool debug)
+Machine::Machine(bool debug, Machine *shared)
 {
     int i;
 
     for (i = 0; i < NumTotalRegs; i++)
         registers[i] = 0;
-    mainMemory = new char[MemorySize];
-    for (i = 0; i < MemorySize; i++)
-      	mainMemory[i] = 0;
-    bitmap = new BitMap(NumPhysPages);
+    ownsMemory = (shared == NULL);
+    if (shared != NULL)
+	mainMemory = shared->mainMemory;
+    else {
+	mainMemory = new char[MemorySize];
+	for (i = 0; i < MemorySize; i++)
+	    mainMemory[i] = 0;
+    }
+    decodeCache = new Instruction[MemorySize / 4];
+    decodeValid = new bool[MemorySize / 4];
+    for (i = 0; i < MemorySize / 4; i++)
+	decodeValid[i] = FALSE;
+    blockCache = new BlockCache();
+    lastBlock = NULL;
+    blockTicks = 0;
 #ifdef USE_TLB
-    tlb = new TranslationEntry[TLBSize];
-    for (i = 0; i < TLBSize; i++){
-	   tlb[i].valid = FALSE;
-       tlb[i].lrutime = 0;
+    if (TLBWays == 0)
+	TLBWays = TLBSize;		// fully associative
+    ASSERT(TLBWays <= TLBSize && TLBSize % TLBWays == 0);
+    for (int cpu = 0; cpu < TLBsPerMachine; cpu++) {
+	cpuTLB[cpu] = new TranslationEntry[TLBSize];
+	for (i = 0; i < TLBSize; i++){
+	    cpuTLB[cpu][i].valid = FALSE;
+	    cpuTLB[cpu][i].lrutime = 0;
+	}
     }
+    tlb = cpuTLB[0];
+    asid = 0;
     tlbinfo.time = tlbinfo.miss = 0;
     pageTable = NULL;
 #else	// use linear page table
     tlb = NULL;
     pageTable = NULL;
 #endif
+    FlushSoftTLB();
 
     singleStep = debug;
     CheckEndian();
@@ -86,9 +116,32 @@ Machine::Machine(bool debug)
 
 Machine::~Machine()
 {
-    delete [] mainMemory;
+    if (ownsMemory)
+	delete [] mainMemory;
+    delete [] decodeCache;
+    delete [] decodeValid;
+    delete blockCache;
+    if (tlb != NULL)
+	for (int cpu = 0; cpu < TLBsPerMachine; cpu++)
+	    delete [] cpuTLB[cpu];
+}
+
+//----------------------------------------------------------------------
+// Machine::SetCPU
+// 	Start simulating another CPU of a multiprocessor: from now on,
+//	translate through its TLB.  The caller is responsible for loading
+//	the registers of the thread that CPU is running.
+//
+//	"which" -- the CPU to switch to
+//----------------------------------------------------------------------
+
+void
+Machine::SetCPU(int which)
+{
     if (tlb != NULL)
-        delete [] tlb;
+	tlb = cpuTLB[which];
+    FlushSoftTLB();
+    lastBlock = NULL;
 }
 
 //----------------------------------------------------------------------
@@ -105,37 +158,28 @@ void
 Machine::RaiseException(ExceptionType which, int badVAddr)
 {
     DEBUG('m', "Exception: %s\n", exceptionNames[which]);
+#ifdef HOST_THREADS
+    if (!currentCPU->inKernel)		// a trap from user code: wait
+	kernelLock->Acquire();		// for the kernel to be free
+#endif
     
 //  ASSERT(interrupt->getStatus() == UserMode);
     registers[BadVAddrReg] = badVAddr;
+    if (profile != NULL && which >= PageFaultException
+			&& which <= AddressErrorException)
+	profile->Stall(currentCPU->id, registers[PCReg], which,
+		       badVAddr == registers[PCReg]);
+    if (blockTicks > 0) {		// the kernel must see the time at
+	interrupt->OneTick(blockTicks);	// which this instruction started
+	blockTicks = 0;
+    }
     DelayedLoad(0, 0);			// finish anything in progress
     interrupt->setStatus(SystemMode);
     ExceptionHandler(which);		// interrupts are enabled at this point
-    interrupt->setStatus(UserMode);
+    FlushSoftTLB();			// the kernel may have changed the
+    interrupt->setStatus(UserMode);	// page table or the TLB
 }
 
-void
-Machine::DeallocatePage()
-{
-    OpenFile *openfile = fileSystem->Open(currentThread->getFileName());
-    for (int i = 0; i < pageTableSize; i++) {
-        if(pageTable[i].valid){
-            pageTable[i].valid = FALSE;
-            if(pageTable[i].dirty){
-                int tsize, fileAddr;
-                fileAddr = pageTable[i].virtualPage * PageSize;
-                tsize = fileAddr + PageSize < currentThread->fileInfo.size ?
-                    PageSize:currentThread->fileInfo.size - fileAddr;
-                openfile->WriteAt(
-                    &(mainMemory[pageTable[i].physicalPage * PageSize]),
-                    tsize, fileAddr);
-            }
-            bitmap->Clear(pageTable[i].physicalPage);
-            printf("phys page %d deallocated.\n", pageTable[i].physicalPage);
-        }
-    }
-    delete openfile;    
-}
 //----------------------------------------------------------------------
 // Machine::Debugger
 // 	Primitive debugger for user programs.  Note that we can't use
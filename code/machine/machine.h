@@ -24,18 +24,51 @@
 #include "copyright.h"
 #include "utility.h"
 #include "translate.h"
+#include "pagetable.h"
 #include "disk.h"
 #include "bitmap.h"
+#include "blockcache.h"
+#include "cpu.h"
 
 // Definitions related to the size, and format of user memory
 
-#define PageSize 	SectorSize 	// set the page size equal to
-					// the disk sector size, for
-					// simplicity
-
-#define NumPhysPages    32
+// The size of pages, of physical memory and of the TLB are set when
+// Nachos starts (-pagesize, -physpages, -tlbsize, -tlbways), before
+// the Machine is created, and don't change after that.  Pages need not
+// be the size of a disk sector; the defaults are the original, tiny,
+// machine.
+
+#define DefaultPageSize		SectorSize
+#define DefaultNumPhysPages	32
+#define DefaultTLBSize		4	// if there is a TLB, make it small
+
+extern int PageSize;			// bytes in a page (a power of 2)
+extern int NumPhysPages;		// pages of physical memory
+extern int TLBSize;			// entries in each TLB
+extern int TLBWays;			// entries in each set of a TLB
+					// (-tlbways; 0 = fully associative)
 #define MemorySize 	(NumPhysPages * PageSize)
-#define TLBSize		4		// if there is a TLB, make it small
+#define TLBSets		(TLBSize / TLBWays)
+
+// TLB entries are tagged with the address space they belong to, so the
+// TLB need not be flushed on a context switch.  A page can only be in
+// one set of the TLB, chosen by hashing its virtual page number and
+// address space ID (see Machine::TLBSet).
+
+#define NumASIDs	64		// address space IDs there are tags for
+#define ASIDHash	0x9e3779b1	// spreads the same page of different
+					// address spaces over the sets
+
+// When the CPUs run on host threads, each has a Machine of its own;
+// otherwise the one Machine holds the TLBs of all of them.
+#ifdef HOST_THREADS
+#define TLBsPerMachine	1
+#else
+#define TLBsPerMachine	numCPUs
+#endif
+
+#define SoftTLBSize	64		// translations remembered by the
+					// simulator itself (a power of 2)
 
 enum ExceptionType { NoException,           // Everything ok!
 		     SyscallException,      // A program executed a system call.
@@ -90,6 +123,23 @@ class Instruction {
     char rs, rt, rd; // Three registers from instruction.
     int extra;       // Immediate or target or shamt field or offset.
                      // Immediates are sign-extended.
+#ifdef THREADED_DISPATCH
+    void *handler;   // Where RunThreaded executes this instruction;
+		     // NULL until it is first dispatched.
+#endif
+};
+
+// The following class defines a translation remembered by the simulator,
+// so that later references to the same page need not go through
+// Machine::Translate.  This is purely a simulator cache, invisible to
+// the kernel, except that it must be flushed when the mappings change.
+
+class SoftTLBEntry {
+  public:
+    int virtualPage;		// -1 if this entry is unused
+    TranslationEntry *entry;	// page table or TLB entry it came from
+    char *host;			// where the page is in mainMemory
+    bool writable;		// FALSE if the page is read-only
 };
 
 // The following class defines the simulated host workstation hardware, as 
@@ -102,13 +152,15 @@ class Instruction {
 // If we were to implement more of the UNIX system calls, we ought to be
 // able to run Nachos on top of Nachos!
 //
-// The procedures in this class are defined in machine.cc, mipssim.cc, and
-// translate.cc.
+// The procedures in this class are defined in machine.cc, mipssim.cc,
+// mipsthreaded.cc, and translate.cc.
 
 class Machine {
   public:
-    Machine(bool debug);	// Initialize the simulation of the hardware
-				// for running user programs
+    Machine(bool debug, Machine *shared = NULL);
+				// Initialize the simulation of the hardware
+				// for running user programs; "shared" is
+				// another CPU whose memory we share
     ~Machine();			// De-allocate the data structures
 
 // Routines callable by the Nachos kernel
@@ -119,11 +171,34 @@ class Machine {
     void WriteRegister(int num, int value);
 				// store a value into a CPU register
 
-    void DeallocatePage();
+    void SetCPU(int which);	// Switch to another CPU's TLB
 // Routines internal to the machine simulation -- DO NOT call these 
 
-    void OneInstruction(Instruction *instr); 	
-    				// Run one instruction of a user program.
+    void OneInstruction(); 	// Run one instruction of a user program.
+    bool ExecuteInstruction(Instruction *instr);
+				// Execute a decoded instruction; FALSE if
+				// it trapped to the kernel
+    void RunBurst();		// Run user code until an interrupt may be
+				// due, and advance simulated time to match
+    bool RunBlock(int limit);	// Run the basic block at the PC, as part
+				// of a burst; FALSE if it trapped
+    int BurstLength();		// How many instructions can run before
+				// an interrupt may be due
+    void CheckSlice();		// Go on to the next CPU, if this one's
+				// turn is over
+#ifdef THREADED_DISPATCH
+    void RunThreaded();		// Run user instructions with threaded
+				// dispatch (mipsthreaded.cc)
+#endif
+    void TraceInstruction(Instruction *instr);
+				// Print the instruction at the PC ('m')
+    Instruction *FetchDecoded(int physAddr);
+				// Return the decoded form of the word at
+				// "physAddr", decoding it only if it isn't
+				// in the decode cache yet
+    void InvalidateDecodeCache(int physPage);
+				// Forget the decoded words of a physical
+				// page whose contents are being replaced
     void DelayedLoad(int nextReg, int nextVal);  	
 				// Do a pending delayed load (modifying a reg)
     void AdvancePC(int pcAfter);
@@ -140,6 +215,24 @@ class Machine {
 				// the translation entry appropriately,
     				// and return an exception code if the 
 				// translation couldn't be completed.
+    bool SoftTranslate(int virtAddr, int* physAddr, int size, bool writing);
+				// Same as Translate, if the translation is
+				// in the soft TLB; else return FALSE
+    void FlushSoftTLB();	// Forget the soft TLB; must be called
+				// when the page table or TLB changes
+    TranslationEntry *FetchEntry(int virtAddr);
+    int TLBSet(int vpn);	// First TLB entry of the set page "vpn"
+				// of the current address space is in
+    void WriteBackTLB(int id, PageTable *table);
+				// Copy the dirty bits and reference times
+				// of an address space's TLB entries back
+				// into its page table
+    void InvalidateTLB(int id, int vpn);
+				// Drop an address space's TLB entries
+				// for page "vpn", or all of them if -1
+    void Touch(TranslationEntry *entry, bool writing);
+				// Update the use, dirty and LRU information
+				// for a reference through "entry"
 
     void RaiseException(ExceptionType which, int badVAddr);
 				// Trap to the Nachos kernel, because of a
@@ -157,9 +250,21 @@ class Machine {
 
     char *mainMemory;		// physical memory to store user program,
 				// code and data, while executing
-    BitMap *bitmap;
     int registers[NumTotalRegs]; // CPU registers, for executing user programs
 
+// Instructions are decoded once per physical word and cached until the
+// word is written or its page is replaced, so that loops don't pay for
+// Instruction::Decode on every iteration.
+//
+// With HOST_THREADS, each CPU's Machine has a cache of its own, which
+// no other CPU touches.  Another CPU may still have written the word,
+// so FetchDecoded also checks it against mainMemory before using it.
+
+    Instruction *decodeCache;	// decoded form of each word of mainMemory
+    bool *decodeValid;		// TRUE if the decodeCache entry for a word
+				// matches what is in mainMemory
+    BlockCache *blockCache;	// basic blocks found so far
+
 
 // NOTE: the hardware translation of virtual addresses in the user program
 // to physical addresses (relative to the beginning of "mainMemory")
@@ -175,23 +280,46 @@ class Machine {
 // 
 // For simplicity, both the page table pointer and the TLB pointer are
 // public.  However, while there can be multiple page tables (one per address
-// space, stored in memory), there is only one TLB (implemented in hardware).
+// space, stored in memory), there is only one TLB per CPU (implemented in
+// hardware), and "tlb" points to the one of the CPU being simulated.
 // Thus the TLB pointer should be considered as *read-only*, although 
 // the contents of the TLB are free to be modified by the kernel software.
 
     TranslationEntry *tlb;		// this pointer should be considered 
 					// "read-only" to Nachos kernel code
+    int asid;				// ID of the address space running,
+					// which TLB entries must match
     struct {
         int time;
         int miss;
     } tlbinfo;
-    TranslationEntry *pageTable;
-    unsigned int pageTableSize;
+    PageTable *pageTable;		// the running address space's, if any
+    unsigned int pageTableSize;		// virtual pages it covers
+    static int lruClock;	// advanced on every reference to memory
+				// by any CPU, to stamp the entry used (see
+				// lrutime); one clock, so that stamps
+				// made on different CPUs compare
+    static int NextLRUTime()	// advance lruClock, return the stamp
+#ifdef HOST_THREADS
+	{ return __sync_add_and_fetch(&lruClock, 1); }
+#else
+	{ return ++lruClock; }
+#endif
   private:
     bool singleStep;		// drop back into the debugger after each
 				// simulated instruction
     int runUntilTime;		// drop back into the debugger when simulated
 				// time reaches this value
+    SoftTLBEntry softTLB[SoftTLBSize];
+				// recent translations, indexed by
+				// virtual page number
+    BasicBlock *lastBlock;	// block that just ran to its end, if any
+    int blockTicks;		// instructions of the current block that
+				// have run but are not yet accounted for
+    TranslationEntry *cpuTLB[MaxCPUs];
+				// each CPU's TLB, if there is a TLB
+    bool ownsMemory;		// FALSE if mainMemory etc. belong to
+				// another CPU's Machine
 };
 
 extern void ExceptionHandler(ExceptionType which);
@@ -16,8 +16,6 @@
 #include "mipssim.h"
 #include "system.h"
 
-static void Mult(int a, int b, bool signedArith, int* hiPtr, int* loPtr);
-
 //----------------------------------------------------------------------
 // Machine::Run
 // 	Simulate the execution of a user-level program on Nachos.
@@ -30,21 +28,184 @@ static void Mult(int a, int b, bool signedArith, int* hiPtr, int* loPtr);
 void
 Machine::Run()
 {
-    Instruction *instr = new Instruction;  // storage for decoded instruction
-
     //printf("Program(%s thread) begins to run...\n", currentThread->getName());
     if(DebugIsEnabled('m'))
         printf("Starting thread \"%s\" at time %d\n",
 	       currentThread->getName(), stats->totalTicks);
     interrupt->setStatus(UserMode);
+#ifdef THREADED_DISPATCH
+    RunThreaded();
+#else
     for (;;) {
-        OneInstruction(instr);
-	interrupt->OneTick();
-	if (singleStep && (runUntilTime <= stats->totalTicks))
-	  Debugger();
+	if (singleStep) {
+	    OneInstruction();
+	    interrupt->OneTick();
+	    if (runUntilTime <= stats->totalTicks)
+		Debugger();
+	    CheckSlice();
+	} else
+	    RunBurst();
     }
+#endif
 }
 
+//----------------------------------------------------------------------
+// Machine::BurstLength
+// 	Return how many user instructions can run before an interrupt
+//	could be due (or, on a multiprocessor, before this CPU's turn is
+//	over), and so before we need to call OneTick.  Always at least one.
+//----------------------------------------------------------------------
+
+int
+Machine::BurstLength()
+{
+    int ticks = interrupt->TicksUntilDue(), length;
+
+#ifdef HOST_THREADS
+    if (kernelLock->InOrder() && CPUQuantum < ticks)
+	ticks = CPUQuantum;
+#else
+    if (numCPUs > 1 && currentCPU->sliceEnd - currentCPU->clock < ticks)
+	ticks = currentCPU->sliceEnd - currentCPU->clock;
+#endif
+    length = ticks / UserTick;
+    return (length > 0) ? length : 1;
+}
+
+//----------------------------------------------------------------------
+// Machine::CheckSlice
+// 	On a multiprocessor, once the CPU being simulated has had its
+//	turn, go on to the next one (see Scheduler::NextCPU).  We get
+//	back here when this CPU's thread is next simulated.
+//----------------------------------------------------------------------
+
+void
+Machine::CheckSlice()
+{
+#ifndef HOST_THREADS			// else the CPUs run side by side
+    IntStatus oldLevel;
+
+    if (numCPUs == 1 || currentCPU->clock < currentCPU->sliceEnd)
+	return;
+    oldLevel = interrupt->SetLevel(IntOff);
+    interrupt->setStatus(SystemMode);
+    scheduler->NextCPU();
+    (void) interrupt->SetLevel(oldLevel);
+    interrupt->setStatus(UserMode);
+#endif
+}
+
+//----------------------------------------------------------------------
+// Machine::RunBurst
+// 	Run basic blocks until the next pending interrupt is due, then
+//	advance simulated time by one tick per instruction executed, all
+//	at once.
+//
+//	Timing is exactly as if OneTick had been called after every
+//	instruction: no interrupt can fire in the middle of the burst,
+//	and if an instruction traps, RaiseException first accounts for
+//	the instructions before it, so the kernel sees the same clock
+//	either way.  A trap ends the burst, since the kernel may have
+//	scheduled new interrupts.
+//
+//	With HOST_THREADS, the burst runs without the kernel lock, at the
+//	same time as other CPUs; RaiseException takes the lock back if
+//	an instruction traps.
+//----------------------------------------------------------------------
+
+void
+Machine::RunBurst()
+{
+    int budget, ticks;
+
+    CheckSlice();
+    budget = BurstLength();
+#ifdef HOST_THREADS
+    kernelLock->Release();
+#endif
+    while (blockTicks < budget)
+	if (!RunBlock(budget - blockTicks))
+	    return;			// trapped; already accounted for
+#ifdef HOST_THREADS
+    kernelLock->Acquire();
+#endif
+    ticks = blockTicks;
+    blockTicks = 0;
+    interrupt->OneTick(ticks);
+}
+
+//----------------------------------------------------------------------
+// Machine::RunBlock
+// 	Run the basic block starting at the PC, as part of a burst.
+//	If the block is longer than "limit" instructions, only its first
+//	instruction is run, since an interrupt will be due before its end.
+//	Each instruction run is added to blockTicks, for RunBurst to
+//	account for.
+//
+//	Returns FALSE if an instruction trapped to the kernel; in that
+//	case the time has already been advanced.
+//
+//	The block stops early whenever the PC is not the next sequential
+//	instruction (for instance, when we restart in a delay slot).
+//----------------------------------------------------------------------
+
+bool
+Machine::RunBlock(int limit)
+{
+    BasicBlock *block, *from = lastBlock;
+    Instruction *instr;
+    ExceptionType exception;
+    int physAddr, i;
+
+    lastBlock = NULL;			// "from" may not survive the Find
+    if (SoftTranslate(registers[PCReg], &physAddr, 4, FALSE))
+	exception = NoException;
+    else
+	exception = Translate(registers[PCReg], &physAddr, 4, FALSE);
+    if (exception != NoException) {
+	RaiseException(exception, registers[PCReg]);
+	interrupt->OneTick();
+	return FALSE;
+    }
+    block = blockCache->Find(from, pageTable, registers[PCReg], physAddr);
+    if (block->length > limit) {
+	instr = FetchDecoded(physAddr);	// an interrupt is due in the
+	if (DebugIsEnabled('m'))	// middle: one at a time
+	    TraceInstruction(instr);
+	if (!ExecuteInstruction(instr)) {
+	    interrupt->OneTick();
+	    return FALSE;
+	}
+	blockTicks++;
+	return TRUE;
+    }
+
+    for (i = 0; i < block->length; i++) {
+	if (i > 0) {
+	    if (registers[PCReg] != block->pc + i * 4)
+		break;			// control left the block
+	    if (SoftTranslate(registers[PCReg], &physAddr, 4, FALSE))
+		exception = NoException;
+	    else
+		exception = Translate(registers[PCReg], &physAddr, 4, FALSE);
+	    if (exception != NoException) {
+		RaiseException(exception, registers[PCReg]);
+		interrupt->OneTick();
+		return FALSE;
+	    }
+	}
+	instr = FetchDecoded(physAddr);
+	if (DebugIsEnabled('m'))
+	    TraceInstruction(instr);
+	if (!ExecuteInstruction(instr)) {
+	    interrupt->OneTick();	// RaiseException did the rest
+	    return FALSE;
+	}
+	blockTicks++;
+    }
+    lastBlock = block;
+    return TRUE;
+}
 
 //----------------------------------------------------------------------
 // TypeToReg
@@ -68,6 +229,23 @@ TypeToReg(RegType reg, Instruction *instr)
     }
 }
 
+//----------------------------------------------------------------------
+// Machine::TraceInstruction
+// 	Print the instruction about to be executed at the current PC.
+//----------------------------------------------------------------------
+
+void
+Machine::TraceInstruction(Instruction *instr)
+{
+    struct OpString *str = &opStrings[instr->opCode];
+
+    ASSERT(instr->opCode <= MaxOpcode);
+    printf("At PC = 0x%x: ", registers[PCReg]);
+    printf(str->string, TypeToReg(str->args[0], instr), 
+	   TypeToReg(str->args[1], instr), TypeToReg(str->args[2], instr));
+    printf("\n");
+}
+
 //----------------------------------------------------------------------
 // Machine::OneInstruction
 // 	Execute one instruction from a user-level program
@@ -92,34 +270,52 @@ TypeToReg(RegType reg, Instruction *instr)
 //----------------------------------------------------------------------
 
 void
-Machine::OneInstruction(Instruction *instr)
+Machine::OneInstruction()
+{
+    Instruction *instr;
+    int physAddr;
+    ExceptionType exception;
+
+    // Fetch instruction, reusing its decoded form if we have seen it before
+    if (SoftTranslate(registers[PCReg], &physAddr, 4, FALSE))
+	exception = NoException;
+    else
+	exception = Translate(registers[PCReg], &physAddr, 4, FALSE);
+    if (exception != NoException) {
+	RaiseException(exception, registers[PCReg]);
+	return;			// exception occurred
+    }
+    instr = FetchDecoded(physAddr);
+
+    if (DebugIsEnabled('m'))
+	TraceInstruction(instr);
+    (void) ExecuteInstruction(instr);
+}
+
+//----------------------------------------------------------------------
+// Machine::ExecuteInstruction
+// 	Execute one already fetched and decoded instruction, the one at
+//	the current PC.
+//
+//	Returns FALSE if the instruction trapped to the kernel (in which
+//	case the exception has already been handled), TRUE otherwise.
+//----------------------------------------------------------------------
+
+bool
+Machine::ExecuteInstruction(Instruction *instr)
 {
-    int raw;
     int nextLoadReg = 0; 	
     int nextLoadValue = 0; 	// record delayed load operation, to apply
 				// in the future
 
-    // Fetch instruction 
-    if (!machine->ReadMem(registers[PCReg], 4, &raw))
-	return;			// exception occurred
-    instr->value = raw;
-    instr->Decode();
-
-    if (DebugIsEnabled('m')) {
-       struct OpString *str = &opStrings[instr->opCode];
-
-       ASSERT(instr->opCode <= MaxOpcode);
-       printf("At PC = 0x%x: ", registers[PCReg]);
-       printf(str->string, TypeToReg(str->args[0], instr), 
-		TypeToReg(str->args[1], instr), TypeToReg(str->args[2], instr));
-       printf("\n");
-       }
-    
     // Compute next pc, but don't install in case there's an error or branch.
     int pcAfter = registers[NextPCReg] + 4;
     int sum, diff, tmp, value;
     unsigned int rs, rt, imm;
 
+    if (profile != NULL)
+	profile->Count(currentCPU->id, registers[PCReg], instr->opCode);
+
     // Execute the instruction (cf. Kane's book)
     switch (instr->opCode) {
 	
@@ -128,7 +324,7 @@ Machine::OneInstruction(Instruction *instr)
 	if (!((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
 	    ((registers[instr->rs] ^ sum) & SIGN_BIT)) {
 	    RaiseException(OverflowException, 0);
-	    return;
+	    return FALSE;
 	}
 	registers[instr->rd] = sum;
 	break;
@@ -138,7 +334,7 @@ Machine::OneInstruction(Instruction *instr)
 	if (!((registers[instr->rs] ^ instr->extra) & SIGN_BIT) &&
 	    ((instr->extra ^ sum) & SIGN_BIT)) {
 	    RaiseException(OverflowException, 0);
-	    return;
+	    return FALSE;
 	}
 	registers[instr->rt] = sum;
 	break;
@@ -233,7 +429,7 @@ Machine::OneInstruction(Instruction *instr)
       case OP_LBU:
 	tmp = registers[instr->rs] + instr->extra;
 	if (!machine->ReadMem(tmp, 1, &value))
-	    return;
+	    return FALSE;
 
 	if ((value & 0x80) && (instr->opCode == OP_LB))
 	    value |= 0xffffff00;
@@ -248,10 +444,10 @@ Machine::OneInstruction(Instruction *instr)
 	tmp = registers[instr->rs] + instr->extra;
 	if (tmp & 0x1) {
 	    RaiseException(AddressErrorException, tmp);
-	    return;
+	    return FALSE;
 	}
 	if (!machine->ReadMem(tmp, 2, &value))
-	    return;
+	    return FALSE;
 
 	if ((value & 0x8000) && (instr->opCode == OP_LH))
 	    value |= 0xffff0000;
@@ -270,10 +466,10 @@ Machine::OneInstruction(Instruction *instr)
 	tmp = registers[instr->rs] + instr->extra;
 	if (tmp & 0x3) {
 	    RaiseException(AddressErrorException, tmp);
-	    return;
+	    return FALSE;
 	}
 	if (!machine->ReadMem(tmp, 4, &value))
-	    return;
+	    return FALSE;
 	nextLoadReg = instr->rt;
 	nextLoadValue = value;
 	break;
@@ -287,7 +483,7 @@ Machine::OneInstruction(Instruction *instr)
 	ASSERT((tmp & 0x3) == 0);  
 
 	if (!machine->ReadMem(tmp, 4, &value))
-	    return;
+	    return FALSE;
 	if (registers[LoadReg] == instr->rt)
 	    nextLoadValue = registers[LoadValueReg];
 	else
@@ -318,7 +514,7 @@ Machine::OneInstruction(Instruction *instr)
 	ASSERT((tmp & 0x3) == 0);  
 
 	if (!machine->ReadMem(tmp, 4, &value))
-	    return;
+	    return FALSE;
 	if (registers[LoadReg] == instr->rt)
 	    nextLoadValue = registers[LoadValueReg];
 	else
@@ -384,13 +580,13 @@ Machine::OneInstruction(Instruction *instr)
       case OP_SB:
 	if (!machine->WriteMem((unsigned) 
 		(registers[instr->rs] + instr->extra), 1, registers[instr->rt]))
-	    return;
+	    return FALSE;
 	break;
 	
       case OP_SH:
 	if (!machine->WriteMem((unsigned) 
 		(registers[instr->rs] + instr->extra), 2, registers[instr->rt]))
-	    return;
+	    return FALSE;
 	break;
 	
       case OP_SLL:
@@ -460,7 +656,7 @@ Machine::OneInstruction(Instruction *instr)
 	if (((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
 	    ((registers[instr->rs] ^ diff) & SIGN_BIT)) {
 	    RaiseException(OverflowException, 0);
-	    return;
+	    return FALSE;
 	}
 	registers[instr->rd] = diff;
 	break;
@@ -472,7 +668,7 @@ Machine::OneInstruction(Instruction *instr)
       case OP_SW:
 	if (!machine->WriteMem((unsigned) 
 		(registers[instr->rs] + instr->extra), 4, registers[instr->rt]))
-	    return;
+	    return FALSE;
 	break;
 	
       case OP_SWL:	  
@@ -483,7 +679,7 @@ Machine::OneInstruction(Instruction *instr)
 	ASSERT((tmp & 0x3) == 0);  
 
 	if (!machine->ReadMem((tmp & ~0x3), 4, &value))
-	    return;
+	    return FALSE;
 	switch (tmp & 0x3) {
 	  case 0:
 	    value = registers[instr->rt];
@@ -502,7 +698,7 @@ Machine::OneInstruction(Instruction *instr)
 	    break;
 	}
 	if (!machine->WriteMem((tmp & ~0x3), 4, value))
-	    return;
+	    return FALSE;
 	break;
     	
       case OP_SWR:	  
@@ -513,7 +709,7 @@ Machine::OneInstruction(Instruction *instr)
 	ASSERT((tmp & 0x3) == 0);  
 
 	if (!machine->ReadMem((tmp & ~0x3), 4, &value))
-	    return;
+	    return FALSE;
 	switch (tmp & 0x3) {
 	  case 0:
 	    value = (value & 0xffffff) | (registers[instr->rt] << 24);
@@ -529,12 +725,12 @@ Machine::OneInstruction(Instruction *instr)
 	    break;
 	}
 	if (!machine->WriteMem((tmp & ~0x3), 4, value))
-	    return;
+	    return FALSE;
 	break;
     	
       case OP_SYSCALL:
 	RaiseException(SyscallException, 0);
-	return; 
+	return FALSE;
 	
       case OP_XOR:
 	registers[instr->rd] = registers[instr->rs] ^ registers[instr->rt];
@@ -547,7 +743,7 @@ Machine::OneInstruction(Instruction *instr)
       case OP_RES:
       case OP_UNIMP:
 	RaiseException(IllegalInstrException, 0);
-	return;
+	return FALSE;
 	
       default:
 	ASSERT(FALSE);
@@ -558,6 +754,7 @@ Machine::OneInstruction(Instruction *instr)
     DelayedLoad(nextLoadReg, nextLoadValue);
     
     AdvancePC(pcAfter);
+    return TRUE;
 }
 
 void
@@ -630,6 +827,57 @@ Instruction::Decode()
     }
 }
 
+//----------------------------------------------------------------------
+// Machine::FetchDecoded
+// 	Return the decoded instruction stored at "physAddr" in mainMemory.
+//	The word is decoded the first time it is fetched; after that the
+//	cached copy is used until WriteMem or InvalidateDecodeCache says
+//	the memory behind it has changed -- or, with HOST_THREADS, until
+//	it no longer matches the word, which another CPU may have written.
+//
+//	"physAddr" -- word-aligned physical address of the instruction
+//----------------------------------------------------------------------
+
+Instruction *
+Machine::FetchDecoded(int physAddr)
+{
+    int word = physAddr / 4;
+    Instruction *instr = &decodeCache[word];
+
+#ifdef HOST_THREADS
+    if (decodeValid[word]
+	&& instr->value != WordToHost(*(unsigned int *) &mainMemory[physAddr]))
+	decodeValid[word] = FALSE;
+#endif
+    if (!decodeValid[word]) {
+	instr->value = WordToHost(*(unsigned int *) &mainMemory[physAddr]);
+	instr->Decode();
+#ifdef THREADED_DISPATCH
+	instr->handler = NULL;
+#endif
+	decodeValid[word] = TRUE;
+    }
+    return instr;
+}
+
+//----------------------------------------------------------------------
+// Machine::InvalidateDecodeCache
+// 	Drop the decoded instructions of one physical page.  Must be called
+//	whenever the kernel replaces the contents of a page frame behind
+//	the simulator's back (e.g. when paging it in from disk).
+//
+//	"physPage" -- the physical page number being replaced
+//----------------------------------------------------------------------
+
+void
+Machine::InvalidateDecodeCache(int physPage)
+{
+    int first = physPage * PageSize / 4;
+
+    for (int i = 0; i < PageSize / 4; i++)
+	decodeValid[first + i] = FALSE;
+}
+
 //----------------------------------------------------------------------
 // Mult
 // 	Simulate R2000 multiplication.
@@ -637,7 +885,7 @@ Instruction::Decode()
 // 	double-length result of the multiplication.
 //----------------------------------------------------------------------
 
-static void
+void
 Mult(int a, int b, bool signedArith, int* hiPtr, int* loPtr)
 {
     if ((a == 0) || (b == 0)) {
@@ -93,6 +93,9 @@
 
 #define IndexToAddr(x) ((x) << 2)
 
+extern void Mult(int a, int b, bool signedArith, int* hiPtr, int* loPtr);
+				// Simulate R2000 multiplication
+
 #define SIGN_BIT	0x80000000
 #define R31		31
 
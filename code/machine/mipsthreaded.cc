@@ -0,0 +1,492 @@
+// mipsthreaded.cc -- threaded-code core for the MIPS simulator
+//
+//   An alternative to the switch statement in Machine::OneInstruction.
+//   Each decoded instruction remembers the address of the code that
+//   executes it, and every handler jumps straight to the next one
+//   instead of returning to a central dispatch loop.  Handlers also
+//   know statically whether they do a delayed load or change the
+//   flow of control, so the common case avoids the general
+//   DelayedLoad/AdvancePC bookkeeping.
+//
+//   The semantics are exactly those of mipssim.cc; the two cores must
+//   produce the same register state and the same simulated time for
+//   every program.
+//
+//   Only compiled in when THREADED_DISPATCH is defined (see
+//   Makefile.common).  Relies on gcc's "labels as values" extension.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#include "machine.h"
+#include "mipssim.h"
+#include "system.h"
+
+#ifdef THREADED_DISPATCH
+
+//----------------------------------------------------------------------
+// Machine::RunThreaded
+// 	Simulate the execution of a user-level program, one instruction
+//	per simulated tick, using threaded dispatch.  Never returns.
+//
+//	As in RunBurst, simulated time is advanced once per burst of
+//	instructions, up to the next time an interrupt may be due.
+//
+//	Like OneInstruction, all state lives in the machine registers and
+//	memory, so this is re-entrant: an exception can switch to another
+//	thread, which runs its own copy of this loop.
+//----------------------------------------------------------------------
+
+void
+Machine::RunThreaded()
+{
+    static void *dispatch[MaxOpcode + 1] = {
+	&&bad, &&op_add, &&op_addi, &&op_addiu,			//  0 -  3
+	&&op_addu, &&op_and, &&op_andi, &&op_beq,		//  4 -  7
+	&&op_bgez, &&op_bgezal, &&op_bgtz, &&op_blez,		//  8 - 11
+	&&op_bltz, &&op_bltzal, &&op_bne, &&bad,		// 12 - 15
+	&&op_div, &&op_divu, &&op_j, &&op_jal,			// 16 - 19
+	&&op_jalr, &&op_jr, &&op_lb, &&op_lbu,			// 20 - 23
+	&&op_lh, &&op_lhu, &&op_lui, &&op_lw,			// 24 - 27
+	&&op_lwl, &&op_lwr, &&bad, &&op_mfhi,			// 28 - 31
+	&&op_mflo, &&bad, &&op_mthi, &&op_mtlo,			// 32 - 35
+	&&op_mult, &&op_multu, &&op_nor, &&op_or,		// 36 - 39
+	&&op_ori, &&bad, &&op_sb, &&op_sh,			// 40 - 43
+	&&op_sll, &&op_sllv, &&op_slt, &&op_slti,		// 44 - 47
+	&&op_sltiu, &&op_sltu, &&op_sra, &&op_srav,		// 48 - 51
+	&&op_srl, &&op_srlv, &&op_sub, &&op_subu,		// 52 - 55
+	&&op_sw, &&op_swl, &&op_swr, &&op_xor,			// 56 - 59
+	&&op_xori, &&op_syscall, &&op_illegal, &&op_illegal	// 60 - 63
+    };
+    Instruction *instr;
+    ExceptionType exception;
+    int physAddr, pcAfter, loadReg, loadValue;
+    int sum, diff, tmp, value;
+    unsigned int rs, rt, imm;
+    int budget = BurstLength();		// instructions left in this burst
+
+#ifdef HOST_THREADS
+    kernelLock->Release();		// see Machine::RunBurst
+#endif
+
+  fetch:
+    if (SoftTranslate(registers[PCReg], &physAddr, 4, FALSE))
+	exception = NoException;
+    else
+	exception = Translate(registers[PCReg], &physAddr, 4, FALSE);
+    if (exception != NoException) {
+	RaiseException(exception, registers[PCReg]);
+	goto trap;
+    }
+    instr = FetchDecoded(physAddr);
+    if (instr->handler == NULL)
+	instr->handler = dispatch[(int) instr->opCode];
+    if (DebugIsEnabled('m'))
+	TraceInstruction(instr);
+    if (profile != NULL)
+	profile->Count(currentCPU->id, registers[PCReg], instr->opCode);
+    goto *instr->handler;
+
+// Handlers that neither load nor branch: finish at "next".
+
+  op_add:
+    sum = registers[instr->rs] + registers[instr->rt];
+    if (!((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
+	((registers[instr->rs] ^ sum) & SIGN_BIT)) {
+	RaiseException(OverflowException, 0);
+	goto trap;
+    }
+    registers[instr->rd] = sum;
+    goto next;
+
+  op_addi:
+    sum = registers[instr->rs] + instr->extra;
+    if (!((registers[instr->rs] ^ instr->extra) & SIGN_BIT) &&
+	((instr->extra ^ sum) & SIGN_BIT)) {
+	RaiseException(OverflowException, 0);
+	goto trap;
+    }
+    registers[instr->rt] = sum;
+    goto next;
+
+  op_addiu:
+    registers[instr->rt] = registers[instr->rs] + instr->extra;
+    goto next;
+
+  op_addu:
+    registers[instr->rd] = registers[instr->rs] + registers[instr->rt];
+    goto next;
+
+  op_and:
+    registers[instr->rd] = registers[instr->rs] & registers[instr->rt];
+    goto next;
+
+  op_andi:
+    registers[instr->rt] = registers[instr->rs] & (instr->extra & 0xffff);
+    goto next;
+
+  op_div:
+    if (registers[instr->rt] == 0) {
+	registers[LoReg] = 0;
+	registers[HiReg] = 0;
+    } else {
+	registers[LoReg] =  registers[instr->rs] / registers[instr->rt];
+	registers[HiReg] = registers[instr->rs] % registers[instr->rt];
+    }
+    goto next;
+
+  op_divu:
+    rs = (unsigned int) registers[instr->rs];
+    rt = (unsigned int) registers[instr->rt];
+    if (rt == 0) {
+	registers[LoReg] = 0;
+	registers[HiReg] = 0;
+    } else {
+	tmp = rs / rt;
+	registers[LoReg] = (int) tmp;
+	tmp = rs % rt;
+	registers[HiReg] = (int) tmp;
+    }
+    goto next;
+
+  op_lui:
+    DEBUG('m', "Executing: LUI r%d,%d\n", instr->rt, instr->extra);
+    registers[instr->rt] = instr->extra << 16;
+    goto next;
+
+  op_mfhi:
+    registers[instr->rd] = registers[HiReg];
+    goto next;
+
+  op_mflo:
+    registers[instr->rd] = registers[LoReg];
+    goto next;
+
+  op_mthi:
+    registers[HiReg] = registers[instr->rs];
+    goto next;
+
+  op_mtlo:
+    registers[LoReg] = registers[instr->rs];
+    goto next;
+
+  op_mult:
+    Mult(registers[instr->rs], registers[instr->rt], TRUE,
+	 &registers[HiReg], &registers[LoReg]);
+    goto next;
+
+  op_multu:
+    Mult(registers[instr->rs], registers[instr->rt], FALSE,
+	 &registers[HiReg], &registers[LoReg]);
+    goto next;
+
+  op_nor:
+    registers[instr->rd] = ~(registers[instr->rs] | registers[instr->rt]);
+    goto next;
+
+  op_or:			// same as OneInstruction, which uses rs twice
+    registers[instr->rd] = registers[instr->rs] | registers[instr->rs];
+    goto next;
+
+  op_ori:
+    registers[instr->rt] = registers[instr->rs] | (instr->extra & 0xffff);
+    goto next;
+
+  op_sb:
+    if (!WriteMem((unsigned) (registers[instr->rs] + instr->extra), 1,
+		  registers[instr->rt]))
+	goto trap;
+    goto next;
+
+  op_sh:
+    if (!WriteMem((unsigned) (registers[instr->rs] + instr->extra), 2,
+		  registers[instr->rt]))
+	goto trap;
+    goto next;
+
+  op_sll:
+    registers[instr->rd] = registers[instr->rt] << instr->extra;
+    goto next;
+
+  op_sllv:
+    registers[instr->rd] = registers[instr->rt] <<
+	(registers[instr->rs] & 0x1f);
+    goto next;
+
+  op_slt:
+    registers[instr->rd] = registers[instr->rs] < registers[instr->rt];
+    goto next;
+
+  op_slti:
+    registers[instr->rt] = registers[instr->rs] < instr->extra;
+    goto next;
+
+  op_sltiu:
+    rs = registers[instr->rs];
+    imm = instr->extra;
+    registers[instr->rt] = rs < imm;
+    goto next;
+
+  op_sltu:
+    rs = registers[instr->rs];
+    rt = registers[instr->rt];
+    registers[instr->rd] = rs < rt;
+    goto next;
+
+  op_sra:
+    registers[instr->rd] = registers[instr->rt] >> instr->extra;
+    goto next;
+
+  op_srav:
+    registers[instr->rd] = registers[instr->rt] >>
+	(registers[instr->rs] & 0x1f);
+    goto next;
+
+  op_srl:
+    tmp = registers[instr->rt];
+    tmp >>= instr->extra;
+    registers[instr->rd] = tmp;
+    goto next;
+
+  op_srlv:
+    tmp = registers[instr->rt];
+    tmp >>= (registers[instr->rs] & 0x1f);
+    registers[instr->rd] = tmp;
+    goto next;
+
+  op_sub:
+    diff = registers[instr->rs] - registers[instr->rt];
+    if (((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
+	((registers[instr->rs] ^ diff) & SIGN_BIT)) {
+	RaiseException(OverflowException, 0);
+	goto trap;
+    }
+    registers[instr->rd] = diff;
+    goto next;
+
+  op_subu:
+    registers[instr->rd] = registers[instr->rs] - registers[instr->rt];
+    goto next;
+
+  op_sw:
+    if (!WriteMem((unsigned) (registers[instr->rs] + instr->extra), 4,
+		  registers[instr->rt]))
+	goto trap;
+    goto next;
+
+  op_swl:
+    tmp = registers[instr->rs] + instr->extra;
+    ASSERT((tmp & 0x3) == 0);		// see OneInstruction
+    if (!ReadMem((tmp & ~0x3), 4, &value))
+	goto trap;
+    value = registers[instr->rt];	// (tmp & 0x3) == 0
+    if (!WriteMem((tmp & ~0x3), 4, value))
+	goto trap;
+    goto next;
+
+  op_swr:
+    tmp = registers[instr->rs] + instr->extra;
+    ASSERT((tmp & 0x3) == 0);		// see OneInstruction
+    if (!ReadMem((tmp & ~0x3), 4, &value))
+	goto trap;
+    value = (value & 0xffffff) | (registers[instr->rt] << 24);
+    if (!WriteMem((tmp & ~0x3), 4, value))
+	goto trap;
+    goto next;
+
+  op_xor:
+    registers[instr->rd] = registers[instr->rs] ^ registers[instr->rt];
+    goto next;
+
+  op_xori:
+    registers[instr->rt] = registers[instr->rs] ^ (instr->extra & 0xffff);
+    goto next;
+
+// Loads: the value reaches the register one instruction later.
+
+  op_lb:
+  op_lbu:
+    tmp = registers[instr->rs] + instr->extra;
+    if (!ReadMem(tmp, 1, &value))
+	goto trap;
+    if ((value & 0x80) && (instr->opCode == OP_LB))
+	value |= 0xffffff00;
+    else
+	value &= 0xff;
+    loadReg = instr->rt;
+    loadValue = value;
+    goto load;
+
+  op_lh:
+  op_lhu:
+    tmp = registers[instr->rs] + instr->extra;
+    if (tmp & 0x1) {
+	RaiseException(AddressErrorException, tmp);
+	goto trap;
+    }
+    if (!ReadMem(tmp, 2, &value))
+	goto trap;
+    if ((value & 0x8000) && (instr->opCode == OP_LH))
+	value |= 0xffff0000;
+    else
+	value &= 0xffff;
+    loadReg = instr->rt;
+    loadValue = value;
+    goto load;
+
+  op_lw:
+    tmp = registers[instr->rs] + instr->extra;
+    if (tmp & 0x3) {
+	RaiseException(AddressErrorException, tmp);
+	goto trap;
+    }
+    if (!ReadMem(tmp, 4, &value))
+	goto trap;
+    loadReg = instr->rt;
+    loadValue = value;
+    goto load;
+
+  op_lwl:
+    tmp = registers[instr->rs] + instr->extra;
+    ASSERT((tmp & 0x3) == 0);		// see OneInstruction
+    if (!ReadMem(tmp, 4, &value))
+	goto trap;
+    loadReg = instr->rt;
+    loadValue = value;			// (tmp & 0x3) == 0
+    goto load;
+
+  op_lwr:
+    tmp = registers[instr->rs] + instr->extra;
+    ASSERT((tmp & 0x3) == 0);		// see OneInstruction
+    if (!ReadMem(tmp, 4, &value))
+	goto trap;
+    if (registers[LoadReg] == instr->rt)
+	loadValue = registers[LoadValueReg];
+    else
+	loadValue = registers[instr->rt];
+    loadValue = (loadValue & 0xffffff00) | ((value >> 24) & 0xff);
+    loadReg = instr->rt;
+    goto load;
+
+// Branches and jumps: compute the instruction after the delay slot.
+
+  op_beq:
+    if (registers[instr->rs] == registers[instr->rt])
+	goto taken;
+    goto next;
+
+  op_bgezal:
+    registers[R31] = registers[NextPCReg] + 4;
+  op_bgez:
+    if (!(registers[instr->rs] & SIGN_BIT))
+	goto taken;
+    goto next;
+
+  op_bgtz:
+    if (registers[instr->rs] > 0)
+	goto taken;
+    goto next;
+
+  op_blez:
+    if (registers[instr->rs] <= 0)
+	goto taken;
+    goto next;
+
+  op_bltzal:
+    registers[R31] = registers[NextPCReg] + 4;
+  op_bltz:
+    if (registers[instr->rs] & SIGN_BIT)
+	goto taken;
+    goto next;
+
+  op_bne:
+    if (registers[instr->rs] != registers[instr->rt])
+	goto taken;
+    goto next;
+
+  op_jal:
+    registers[R31] = registers[NextPCReg] + 4;
+  op_j:
+    pcAfter = ((registers[NextPCReg] + 4) & 0xf0000000) |
+	IndexToAddr(instr->extra);
+    goto jump;
+
+  op_jalr:
+    registers[instr->rd] = registers[NextPCReg] + 4;
+  op_jr:
+    pcAfter = registers[instr->rs];
+    goto jump;
+
+// Traps: the kernel takes over, the PC is left alone.
+
+  op_syscall:
+    RaiseException(SyscallException, 0);
+    goto trap;
+
+  op_illegal:
+    RaiseException(IllegalInstrException, 0);
+    goto trap;
+
+  bad:
+    ASSERT(FALSE);
+
+// Common tails.  Each one retires the previous delayed load, queues
+// the new one (if any) and advances the PC.
+
+  taken:
+    pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
+  jump:
+    registers[registers[LoadReg]] = registers[LoadValueReg];
+    registers[LoadReg] = 0;
+    registers[LoadValueReg] = 0;
+    registers[0] = 0;
+    registers[PrevPCReg] = registers[PCReg];
+    registers[PCReg] = registers[NextPCReg];
+    registers[NextPCReg] = pcAfter;
+    goto tick;
+
+  load:
+    registers[registers[LoadReg]] = registers[LoadValueReg];
+    registers[LoadReg] = loadReg;
+    registers[LoadValueReg] = loadValue;
+    registers[0] = 0;
+    goto advance;
+
+  next:
+    registers[registers[LoadReg]] = registers[LoadValueReg];
+    registers[LoadReg] = 0;
+    registers[LoadValueReg] = 0;
+    registers[0] = 0;
+  advance:
+    registers[PrevPCReg] = registers[PCReg];
+    registers[PCReg] = registers[NextPCReg];
+    registers[NextPCReg] += 4;
+
+  tick:					// one more instruction done
+    if (++blockTicks < budget && !singleStep)
+	goto fetch;
+#ifdef HOST_THREADS
+    kernelLock->Acquire();
+#endif
+    tmp = blockTicks;			// end of the burst: account for it
+    blockTicks = 0;
+    interrupt->OneTick(tmp);
+    goto burst;
+
+  trap:					// RaiseException accounted for
+    interrupt->OneTick();		// the rest of the burst
+  burst:
+    if (singleStep && (runUntilTime <= stats->totalTicks))
+	Debugger();
+    CheckSlice();
+    budget = BurstLength();
+#ifdef HOST_THREADS
+    kernelLock->Release();
+#endif
+    goto fetch;
+}
+
+#endif // THREADED_DISPATCH
@@ -65,12 +65,23 @@ Network::CheckPktAvail()
 
     if (inHdr.length != 0) 	// do nothing if packet is already buffered
 	return;		
-    if (!PollSocket(sock)) 	// do nothing if no packet to be read
-	return;
 
-    // otherwise, read packet in
+    // otherwise, read packet in, if there is one to be read
     char *buffer = new char[MaxWireSize];
-    ReadFromSocket(sock, buffer, MaxWireSize);
+    if (inputLog != NULL && inputLog->Replaying()) {
+	if (!inputLog->Replay(PacketInput, buffer, MaxWireSize)) {
+	    delete []buffer;
+	    return;
+	}
+    } else {
+	if (!PollSocket(sock)) {
+	    delete []buffer;
+	    return;
+	}
+	ReadFromSocket(sock, buffer, MaxWireSize);
+	if (inputLog != NULL)
+	    inputLog->Record(PacketInput, buffer, MaxWireSize);
+    }
 
     // divide packet into header and data
     inHdr = *(PacketHeader *)buffer;
@@ -113,7 +124,9 @@ Network::Send(PacketHeader hdr, char* data)
 
     interrupt->Schedule(NetworkSendDone, (int)this, NetworkTime, NetworkSendInt);
 
-    if (Random() % 100 >= chanceToWork * 100) { // emulate a lost packet
+    int random = (inputLog != NULL) ? inputLog->Random() : Random();
+
+    if (random % 100 >= chanceToWork * 100) { // emulate a lost packet
 	DEBUG('n', "oops, lost it!\n");
 	return;
     }
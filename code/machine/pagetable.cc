@@ -0,0 +1,320 @@
+// pagetable.cc
+//	Routines to look up and change the entries of the three kinds of
+//	page table described in pagetable.h.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "pagetable.h"
+#include "machine.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// ClearEntry
+// 	Set up "entry" as a valid, unused, clean mapping of virtual page
+//	"vpn" to physical page "frame".
+//----------------------------------------------------------------------
+
+static void
+ClearEntry(TranslationEntry *entry, int vpn, int frame)
+{
+    entry->virtualPage = vpn;
+    entry->physicalPage = frame;
+    entry->valid = TRUE;
+    entry->readOnly = FALSE;
+    entry->use = FALSE;
+    entry->dirty = FALSE;
+    entry->lrutime = 0;
+}
+
+//----------------------------------------------------------------------
+// NewPageTable
+// 	Return a page table for an address space of "numPages" virtual
+//	pages, of the kind chosen on the command line.
+//----------------------------------------------------------------------
+
+PageTable *
+NewPageTable(int numPages)
+{
+    switch (pageTableKind) {
+      case TwoLevelTable:
+	return new TwoLevelPageTable(numPages);
+      case InvertedTable:
+	return new InvertedPageTable();
+      default:
+	return new LinearPageTable(numPages);
+    }
+}
+
+//----------------------------------------------------------------------
+// LinearPageTable::LinearPageTable
+// 	Allocate an entry for every virtual page, none of them valid.
+//----------------------------------------------------------------------
+
+LinearPageTable::LinearPageTable(int n)
+{
+    numPages = n;
+    table = new TranslationEntry[numPages];
+    for (int i = 0; i < numPages; i++) {
+	table[i].virtualPage = i;
+	table[i].valid = FALSE;
+	table[i].lrutime = 0;
+    }
+}
+
+LinearPageTable::~LinearPageTable()
+{
+    delete [] table;
+}
+
+TranslationEntry *
+LinearPageTable::Lookup(int vpn)
+{
+    if (vpn < 0 || vpn >= numPages)
+	return NULL;
+    return &table[vpn];
+}
+
+TranslationEntry *
+LinearPageTable::Map(int vpn, int frame)
+{
+    ASSERT(vpn >= 0 && vpn < numPages);
+    ClearEntry(&table[vpn], vpn, frame);
+    return &table[vpn];
+}
+
+void
+LinearPageTable::Unmap(int vpn)
+{
+    table[vpn].valid = FALSE;
+}
+
+TranslationEntry *
+LinearPageTable::NextValid(int *position)
+{
+    for (; *position < numPages; (*position)++)
+	if (table[*position].valid)
+	    return &table[(*position)++];
+    return NULL;
+}
+
+int
+LinearPageTable::Size()
+{
+    return numPages * sizeof(TranslationEntry);
+}
+
+//----------------------------------------------------------------------
+// TwoLevelPageTable::TwoLevelPageTable
+// 	Allocate just the directory; the second-level tables come later.
+//----------------------------------------------------------------------
+
+TwoLevelPageTable::TwoLevelPageTable(int numPages)
+{
+    numTables = divRoundUp(numPages, SecondLevelSize);
+    directory = new TranslationEntry *[numTables];
+    for (int i = 0; i < numTables; i++)
+	directory[i] = NULL;
+    numAllocated = 0;
+}
+
+TwoLevelPageTable::~TwoLevelPageTable()
+{
+    for (int i = 0; i < numTables; i++)
+	delete [] directory[i];
+    delete [] directory;
+}
+
+TranslationEntry *
+TwoLevelPageTable::Lookup(int vpn)
+{
+    TranslationEntry *second;
+
+    if (vpn < 0 || vpn / SecondLevelSize >= numTables)
+	return NULL;
+    second = directory[vpn / SecondLevelSize];
+    if (second == NULL)
+	return NULL;
+    return &second[vpn % SecondLevelSize];
+}
+
+//----------------------------------------------------------------------
+// TwoLevelPageTable::Map
+// 	Map a page, allocating the second-level table that covers it if
+//	this is the first of its pages to be mapped.
+//----------------------------------------------------------------------
+
+TranslationEntry *
+TwoLevelPageTable::Map(int vpn, int frame)
+{
+    TranslationEntry **second = &directory[vpn / SecondLevelSize];
+    TranslationEntry *entry;
+
+    ASSERT(vpn >= 0 && vpn / SecondLevelSize < numTables);
+    if (*second == NULL) {
+	*second = new TranslationEntry[SecondLevelSize];
+	for (int i = 0; i < SecondLevelSize; i++) {
+	    (*second)[i].valid = FALSE;
+	    (*second)[i].lrutime = 0;
+	}
+	numAllocated++;
+    }
+    entry = &(*second)[vpn % SecondLevelSize];
+    ClearEntry(entry, vpn, frame);
+    return entry;
+}
+
+void
+TwoLevelPageTable::Unmap(int vpn)
+{
+    TranslationEntry *entry = Lookup(vpn);
+
+    if (entry != NULL)
+	entry->valid = FALSE;
+}
+
+TranslationEntry *
+TwoLevelPageTable::NextValid(int *position)
+{
+    for (; *position < numTables * SecondLevelSize; (*position)++) {
+	TranslationEntry *second = directory[*position / SecondLevelSize];
+
+	if (second == NULL)		// skip the whole table
+	    *position = (*position / SecondLevelSize + 1) * SecondLevelSize - 1;
+	else if (second[*position % SecondLevelSize].valid)
+	    return &second[(*position)++ % SecondLevelSize];
+    }
+    return NULL;
+}
+
+int
+TwoLevelPageTable::Size()
+{
+    return numTables * sizeof(TranslationEntry *)
+	+ numAllocated * SecondLevelSize * sizeof(TranslationEntry);
+}
+
+//----------------------------------------------------------------------
+// InvertedPageTable::InvertedPageTable
+// 	Start an address space's view of the inverted page table, which
+//	is allocated when the first one is created.
+//----------------------------------------------------------------------
+
+TranslationEntry *InvertedPageTable::frames = NULL;
+InvertedPageTable **InvertedPageTable::owners;
+int *InvertedPageTable::chain;
+int *InvertedPageTable::buckets;
+
+InvertedPageTable::InvertedPageTable()
+{
+    if (frames != NULL)
+	return;
+    frames = new TranslationEntry[NumPhysPages];
+    owners = new InvertedPageTable *[NumPhysPages];
+    chain = new int[NumPhysPages];
+    buckets = new int[NumPhysPages];
+    for (int i = 0; i < NumPhysPages; i++) {
+	frames[i].valid = FALSE;
+	owners[i] = NULL;
+	buckets[i] = -1;
+    }
+}
+
+InvertedPageTable::~InvertedPageTable()
+{
+    TranslationEntry *entry;
+    int position = 0;
+
+    while ((entry = NextValid(&position)) != NULL)
+	Unmap(entry->virtualPage);
+}
+
+//----------------------------------------------------------------------
+// InvertedPageTable::Hash
+// 	Return the hash chain that page "vpn" of this address space is
+//	on, if it is in memory.
+//----------------------------------------------------------------------
+
+int
+InvertedPageTable::Hash(int vpn)
+{
+    return (unsigned) (vpn ^ ((long) this >> 4)) % NumPhysPages;
+}
+
+TranslationEntry *
+InvertedPageTable::Lookup(int vpn)
+{
+    for (int f = buckets[Hash(vpn)]; f != -1; f = chain[f])
+	if (owners[f] == this && frames[f].virtualPage == vpn)
+	    return &frames[f];
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// InvertedPageTable::Map
+// 	Map a page into the entry of its physical page, which must not
+//	hold any other page.
+//----------------------------------------------------------------------
+
+TranslationEntry *
+InvertedPageTable::Map(int vpn, int frame)
+{
+    int h = Hash(vpn);
+
+    ASSERT(owners[frame] == NULL);
+    owners[frame] = this;
+    chain[frame] = buckets[h];
+    buckets[h] = frame;
+    ClearEntry(&frames[frame], vpn, frame);
+    return &frames[frame];
+}
+
+//----------------------------------------------------------------------
+// InvertedPageTable::Unmap
+// 	Take a page off its hash chain, and free the entry of its
+//	physical page.
+//----------------------------------------------------------------------
+
+void
+InvertedPageTable::Unmap(int vpn)
+{
+    int *link;
+
+    for (link = &buckets[Hash(vpn)]; *link != -1; link = &chain[*link])
+	if (owners[*link] == this && frames[*link].virtualPage == vpn) {
+	    int f = *link;
+
+	    *link = chain[f];
+	    owners[f] = NULL;
+	    frames[f].valid = FALSE;
+	    return;
+	}
+}
+
+TranslationEntry *
+InvertedPageTable::NextValid(int *position)
+{
+    for (; *position < NumPhysPages; (*position)++)
+	if (owners[*position] == this && frames[*position].valid)
+	    return &frames[(*position)++];
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// InvertedPageTable::Size
+// 	Return what an address space's share of the table costs: its
+//	entries, and their hash chain links and owner tags.
+//----------------------------------------------------------------------
+
+int
+InvertedPageTable::Size()
+{
+    int position = 0, n = 0;
+
+    while (NextValid(&position) != NULL)
+	n++;
+    return n * (sizeof(TranslationEntry) + sizeof(InvertedPageTable *)
+		+ 2 * sizeof(int));
+}
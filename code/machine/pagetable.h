@@ -0,0 +1,132 @@
+// pagetable.h
+//	Data structures for the page tables that translate the virtual
+//	pages of an address space into physical pages.
+//
+//	The machine (Translate, when there is no TLB) and the kernel (the
+//	TLB refill, and the paging code) only use a page table through the
+//	PageTable interface below, so the way it is laid out in memory can
+//	be chosen with -pt:
+//
+//	linear -- one TranslationEntry per virtual page, whether the page
+//		is ever used or not (the original Nachos page table)
+//	twolevel -- a directory of pointers to second-level tables of
+//		SecondLevelSize entries each, allocated the first time a
+//		page they cover is mapped; unused parts of a large, sparse
+//		address space cost one pointer per SecondLevelSize pages
+//	inverted -- one TranslationEntry per physical page, shared by all
+//		address spaces, found by hashing the address space and
+//		virtual page number; its size depends only on the size of
+//		physical memory.  Only pages in memory have entries.
+//
+//	With all three, an entry can only be relied on while the page is
+//	mapped: Unmap may free it, or give it to another page.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PAGETABLE_H
+#define PAGETABLE_H
+
+#include "copyright.h"
+#include "utility.h"
+#include "translate.h"
+
+#define SecondLevelSize	64		// entries in each second-level table
+
+enum PageTableKind { LinearTable, TwoLevelTable, InvertedTable };
+
+// The following class defines the interface to a page table.
+
+class PageTable {
+  public:
+    virtual ~PageTable() {}
+
+    virtual TranslationEntry *Lookup(int vpn) = 0;
+					// Return the entry for page "vpn",
+					// or NULL if there is none (an entry
+					// may be there but not be valid)
+    virtual TranslationEntry *Map(int vpn, int frame) = 0;
+					// Map page "vpn" to physical page
+					// "frame", and return its entry,
+					// valid and otherwise cleared
+    virtual void Unmap(int vpn) = 0;	// Page "vpn" has left memory
+    virtual TranslationEntry *NextValid(int *position) = 0;
+					// Return the next valid entry, in
+					// no particular order, or NULL when
+					// there are no more.  "*position"
+					// starts at 0; the entry returned
+					// may be unmapped before the next
+					// call
+    virtual int Size() = 0;		// Bytes of memory the table takes
+};
+
+// A linear page table: an array indexed by virtual page number.
+
+class LinearPageTable : public PageTable {
+  public:
+    LinearPageTable(int numPages);	// For virtual pages 0..numPages-1
+    ~LinearPageTable();
+
+    TranslationEntry *Lookup(int vpn);
+    TranslationEntry *Map(int vpn, int frame);
+    void Unmap(int vpn);
+    TranslationEntry *NextValid(int *position);
+    int Size();
+
+  private:
+    TranslationEntry *table;		// one entry per virtual page
+    int numPages;
+};
+
+// A two-level page table: the high bits of the virtual page number
+// index a directory, whose entries point to second-level tables indexed
+// by the low bits.
+
+class TwoLevelPageTable : public PageTable {
+  public:
+    TwoLevelPageTable(int numPages);	// For virtual pages 0..numPages-1
+    ~TwoLevelPageTable();
+
+    TranslationEntry *Lookup(int vpn);
+    TranslationEntry *Map(int vpn, int frame);
+    void Unmap(int vpn);
+    TranslationEntry *NextValid(int *position);
+    int Size();
+
+  private:
+    TranslationEntry **directory;	// second-level tables, or NULL
+					// until a page in one is mapped
+    int numTables;			// entries in the directory
+    int numAllocated;			// second-level tables allocated
+};
+
+// An inverted page table: each address space's table is a view of the
+// one table of physical pages, holding the entries tagged with it.
+
+class InvertedPageTable : public PageTable {
+  public:
+    InvertedPageTable();		// An address space with no pages
+    ~InvertedPageTable();		// Unmap whatever is left
+
+    TranslationEntry *Lookup(int vpn);
+    TranslationEntry *Map(int vpn, int frame);
+    void Unmap(int vpn);
+    TranslationEntry *NextValid(int *position);
+    int Size();
+
+  private:
+    int Hash(int vpn);			// Chain page "vpn" of ours is on
+
+    static TranslationEntry *frames;	// one entry per physical page
+    static InvertedPageTable **owners;	// whose page each frame holds
+    static int *chain;			// next frame on the same hash chain
+    static int *buckets;		// first frame on each hash chain,
+					// or -1
+};
+
+extern PageTable *NewPageTable(int numPages);
+					// Create a page table of the kind
+					// chosen with -pt
+
+#endif // PAGETABLE_H
@@ -0,0 +1,179 @@
+// profile.cc
+//	Routines to count where user programs spend their time, and to
+//	write out the counts as a flat profile.
+//
+//	The profile is a text file, one count per line:
+//
+//		total <ticks> <stalls>
+//		pc <address> <ticks> <stalls>		(one per address run)
+//		op <mnemonic> <instructions>		(one per opcode run)
+//		stall <trap> <data> <fetch>		(one per kind of trap)
+//
+//	Addresses are in hex, everything else in decimal.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "profile.h"
+#include "mipssim.h"
+#include "sysdep.h"
+
+// names of the traps a memory reference can take, as written out
+static char *stallNames[] = { NULL, NULL, "pagefault", "readonly",
+			      "buserror", "addresserror", NULL, NULL };
+
+//----------------------------------------------------------------------
+// ProfileCounts::ProfileCounts
+// 	Initialize one CPU's counts, with nothing counted yet.
+//----------------------------------------------------------------------
+
+ProfileCounts::ProfileCounts()
+{
+    hits = NULL;
+    stalls = NULL;
+    numWords = 0;
+    ops = new int[MaxOpcode + 1];
+    for (int i = 0; i <= MaxOpcode; i++)
+	ops[i] = 0;
+    for (int i = 0; i < NumExceptionTypes; i++)
+	stallTypes[i][0] = stallTypes[i][1] = 0;
+}
+
+//----------------------------------------------------------------------
+// ProfileCounts::~ProfileCounts
+// 	De-allocate the counts.
+//----------------------------------------------------------------------
+
+ProfileCounts::~ProfileCounts()
+{
+    delete [] hits;
+    delete [] stalls;
+    delete [] ops;
+}
+
+//----------------------------------------------------------------------
+// ProfileCounts::Grow
+// 	Make the per-address counts big enough to count "pc", by at
+//	least doubling them.
+//----------------------------------------------------------------------
+
+void
+ProfileCounts::Grow(int pc)
+{
+    int size = (numWords > 0) ? numWords : PageSize / 4;
+    int *newHits, *newStalls;
+
+    while ((unsigned) pc / 4 >= (unsigned) size)
+	size *= 2;
+    newHits = new int[size];
+    newStalls = new int[size];
+    for (int i = 0; i < size; i++) {
+	newHits[i] = (i < numWords) ? hits[i] : 0;
+	newStalls[i] = (i < numWords) ? stalls[i] : 0;
+    }
+    delete [] hits;
+    delete [] stalls;
+    hits = newHits;
+    stalls = newStalls;
+    numWords = size;
+}
+
+//----------------------------------------------------------------------
+// Profile::Profile
+// 	Initialize an empty profile.
+//
+//	"name" -- the file to write the profile to, when Nachos halts
+//----------------------------------------------------------------------
+
+Profile::Profile(char *name)
+{
+    fileName = name;
+}
+
+//----------------------------------------------------------------------
+// Profile::Stall
+// 	Count a trap taken by a memory reference.  If the trap came from
+//	fetching the instruction, Count is never called for it, but the
+//	attempt still took a tick: count that here.
+//
+//	"cpu" -- the CPU it happened on
+//	"pc" -- the instruction making the reference
+//	"which" -- the kind of trap
+//	"fetch" -- TRUE if it was fetching the instruction itself
+//----------------------------------------------------------------------
+
+void
+Profile::Stall(int cpu, int pc, ExceptionType which, bool fetch)
+{
+    ProfileCounts *c = &counts[cpu];
+
+    if ((unsigned) pc / 4 >= (unsigned) c->numWords)
+	c->Grow(pc);
+    c->stalls[(unsigned) pc / 4]++;
+    if (fetch)
+	c->hits[(unsigned) pc / 4]++;
+    c->stallTypes[which][fetch ? 1 : 0]++;
+}
+
+//----------------------------------------------------------------------
+// Profile::Write
+// 	Add every CPU's counts into the first one's, and write them out
+//	to the profile file, in the format described at the top of this
+//	file.  Called once all the CPUs have stopped.
+//----------------------------------------------------------------------
+
+void
+Profile::Write()
+{
+    int fd = OpenForWrite(fileName);
+    char line[80], name[20];
+    int totalHits = 0, totalStalls = 0;
+    ProfileCounts *all = &counts[0], *c;
+
+    for (int cpu = 1; cpu < MaxCPUs; cpu++) {
+	c = &counts[cpu];
+	if (c->numWords > all->numWords)
+	    all->Grow((c->numWords - 1) * 4);
+	for (int i = 0; i < c->numWords; i++) {
+	    all->hits[i] += c->hits[i];
+	    all->stalls[i] += c->stalls[i];
+	}
+	for (int i = 0; i <= MaxOpcode; i++)
+	    all->ops[i] += c->ops[i];
+	for (int i = 0; i < NumExceptionTypes; i++) {
+	    all->stallTypes[i][0] += c->stallTypes[i][0];
+	    all->stallTypes[i][1] += c->stallTypes[i][1];
+	}
+    }
+
+    for (int i = 0; i < all->numWords; i++) {
+	totalHits += all->hits[i];
+	totalStalls += all->stalls[i];
+    }
+    sprintf(line, "total %d %d\n", totalHits, totalStalls);
+    WriteFile(fd, line, strlen(line));
+
+    for (int i = 0; i < all->numWords; i++)
+	if (all->hits[i] > 0 || all->stalls[i] > 0) {
+	    sprintf(line, "pc 0x%x %d %d\n", i * 4, all->hits[i],
+		    all->stalls[i]);
+	    WriteFile(fd, line, strlen(line));
+	}
+
+    for (int i = 0; i <= MaxOpcode; i++)
+	if (all->ops[i] > 0) {	// mnemonic is up to the first blank
+	    sscanf(opStrings[i].string, "%19s", name);
+	    sprintf(line, "op %s %d\n", name, all->ops[i]);
+	    WriteFile(fd, line, strlen(line));
+	}
+
+    for (int i = 0; i < NumExceptionTypes; i++)
+	if (stallNames[i] != NULL) {
+	    sprintf(line, "stall %s %d %d\n", stallNames[i],
+		    all->stallTypes[i][0], all->stallTypes[i][1]);
+	    WriteFile(fd, line, strlen(line));
+	}
+    Close(fd);
+}
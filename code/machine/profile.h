@@ -0,0 +1,78 @@
+// profile.h
+//	Data structures for profiling user programs.
+//
+//	With -prof, every user instruction executed is counted, both by
+//	its address and by its opcode, and so is every trap taken by a
+//	memory reference (a "stall"), by the kind of trap and by whether
+//	it came from fetching the instruction or from a load or store.
+//	Each instruction takes one tick, and so does an attempt to fetch
+//	one that traps; both are counted against the address, so the
+//	counts per address add up to the user time in the statistics.
+//
+//	When Nachos halts, the counts are written out as a flat profile,
+//	which bin/coffprof matches up with the procedures in the
+//	program's COFF file.
+//
+//	The counts cover the whole run, so profile one program at a time:
+//	with several, the counts for the same address are added together.
+//
+//	Each CPU counts into a table of its own, so that with HOST_THREADS
+//	the CPUs never touch each other's counts; Write adds them up.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "copyright.h"
+#include "utility.h"
+#include "machine.h"
+#include "cpu.h"
+
+// The following class defines the counts kept by one CPU.
+
+class ProfileCounts {
+  public:
+    ProfileCounts();			// Start with nothing counted
+    ~ProfileCounts();			// De-allocate the counts
+
+    void Grow(int pc);			// Make room to count "pc"
+
+    int *hits;				// ticks spent, by pc / 4
+    int *stalls;			// memory traps taken, by pc / 4
+    int numWords;			// size of hits and stalls
+    int *ops;				// instructions executed, by opcode
+    int stallTypes[NumExceptionTypes][2];	// memory traps, by type, and
+					// by data access (0) or fetch (1)
+};
+
+// The following class defines the profile of the user programs run.
+
+class Profile {
+  public:
+    Profile(char *name);		// Start counting; "name" is the
+					// file to write the profile to
+
+    void Count(int cpu, int pc, int opCode) {
+					// One instruction executed on "cpu"
+	ProfileCounts *c = &counts[cpu];
+
+	if ((unsigned) pc / 4 >= (unsigned) c->numWords)
+	    c->Grow(pc);
+	c->hits[(unsigned) pc / 4]++;
+	c->ops[opCode]++;
+    }
+    void Stall(int cpu, int pc, ExceptionType which, bool fetch);
+					// The instruction at "pc" trapped
+					// on a memory reference
+    void Write();			// Add up the CPUs' counts, and
+					// write out the flat profile
+
+  private:
+    char *fileName;			// where the profile goes
+    ProfileCounts counts[MaxCPUs];	// what each CPU has counted
+};
+
+#endif // PROFILE_H
@@ -22,6 +22,12 @@ Statistics::Statistics()
     numDiskReads = numDiskWrites = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numPageReplacements = numPageOuts = numFramesScanned = 0;
+    numCopiesOnWrite = numZeroFills = numExecutableReads = numSwapReads = 0;
+    numTextShares = 0;
+    numPrefetches = numPrefetchHits = 0;
+    numPagerWakeups = numPagesReclaimed = 0;
+    maxPageTableBytes = 0;
 }
 
 //----------------------------------------------------------------------
@@ -38,7 +44,20 @@ Statistics::Print()
     printf("Disk I/O: reads %d, writes %d\n", numDiskReads, numDiskWrites);
     printf("Console I/O: reads %d, writes %d\n", numConsoleCharsRead, 
 	numConsoleCharsWritten);
-    printf("Paging: faults %d\n", numPageFaults);
+    printf("Paging: faults %d, replacements %d, writes %d, frames scanned %d, "
+	"copies on write %d\n", numPageFaults, numPageReplacements,
+	numPageOuts, numFramesScanned, numCopiesOnWrite);
+    printf("Page-ins: zero-filled %d, from executables %d, from swap %d, "
+	"shared code %d\n", numZeroFills, numExecutableReads, numSwapReads,
+	numTextShares);
+    if (numPrefetches > 0)
+	printf("Prefetch: pages %d, used %d (%.1f%%)\n", numPrefetches,
+	    numPrefetchHits, 100.0 * numPrefetchHits / numPrefetches);
+    if (numPagerWakeups > 0)
+	printf("Pager: woken %d times, pages replaced %d\n", numPagerWakeups,
+	    numPagesReclaimed);
+    if (maxPageTableBytes > 0)
+	printf("Page tables: largest %d bytes\n", maxPageTableBytes);
     printf("Network I/O: packets received %d, sent %d\n", numPacketsRecvd, 
 	numPacketsSent);
 }
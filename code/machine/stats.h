@@ -33,6 +33,22 @@ class Statistics {
     int numConsoleCharsRead;	// number of characters read from the keyboard
     int numConsoleCharsWritten; // number of characters written to the display
     int numPageFaults;		// number of virtual memory page faults
+    int numPageReplacements;	// faults that had to replace a page
+    int numPageOuts;		// pages written out to the swap space
+    int numFramesScanned;	// frames looked at by the replacement
+				// policy, choosing pages to replace
+    int numCopiesOnWrite;	// writes to pages shared after a Fork
+    int numZeroFills;		// pages brought in just by zeroing them
+    int numExecutableReads;	// pages read in from an executable
+    int numSwapReads;		// pages read in from the swap space
+    int numTextShares;		// code pages found in memory already,
+				// for another address space
+    int numPrefetches;		// pages read in before being faulted on
+    int numPrefetchHits;	// prefetched pages used before they
+				// left memory
+    int numPagerWakeups;	// times the pager was woken
+    int numPagesReclaimed;	// pages replaced by the pager
+    int maxPageTableBytes;	// memory taken by the largest page table
     int numPacketsSent;		// number of packets sent over the network
     int numPacketsRecvd;	// number of packets received over the network
 
@@ -78,7 +78,9 @@ Timer::TimerExpired()
 int 
 Timer::TimeOfNextInterrupt() 
 {
-    if (randomize)
+    if (randomize && inputLog != NULL)
+	return 1 + (inputLog->Random() % (TimerTicks * 2));
+    else if (randomize)
 	return 1 + (Random() % (TimerTicks * 2));
     else
 	return TimerTicks; 
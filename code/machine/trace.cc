@@ -0,0 +1,112 @@
+// trace.cc
+//	Routines to record the pages referred to by user programs, in
+//	the format described in trace.h.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "trace.h"
+#include "machine.h"
+#include "system.h"
+#include "sysdep.h"
+
+//----------------------------------------------------------------------
+// Trace::Trace
+// 	Create the trace file, and write its header.
+//
+//	"name" -- the file to write the trace to
+//----------------------------------------------------------------------
+
+Trace::Trace(char *name)
+{
+    TraceHeader header;
+
+    file = OpenForWrite(name);
+    header.magic = TraceMagic;
+    header.pageSize = PageSize;
+    header.numPhysPages = NumPhysPages;
+#ifdef USE_TLB
+    header.tlbSize = TLBSize;
+#else
+    header.tlbSize = 0;
+#endif
+    WriteFile(file, (char *) &header, sizeof(header));
+    numBuffered = 0;
+#ifdef HOST_THREADS
+    pthread_mutex_init(&mutex, NULL);
+#endif
+}
+
+//----------------------------------------------------------------------
+// Trace::~Trace
+// 	Write out whatever is still buffered, and close the trace file.
+//----------------------------------------------------------------------
+
+Trace::~Trace()
+{
+    Flush();
+    Close(file);
+#ifdef HOST_THREADS
+    pthread_mutex_destroy(&mutex);
+#endif
+}
+
+//----------------------------------------------------------------------
+// Trace::Record
+// 	Log a reference by the current thread.
+//
+//	"vpn" -- the virtual page referred to
+//	"writing" -- TRUE if the reference was a store
+//----------------------------------------------------------------------
+
+void
+Trace::Record(int vpn, bool writing)
+{
+    Append(((unsigned) vpn << 8) | (currentThread->getTid() << 1)
+	   | (writing ? 1 : 0));
+}
+
+//----------------------------------------------------------------------
+// Trace::Exit
+// 	Log that the current thread's pages are being de-allocated, so
+//	that its thread id no longer names the same address space.
+//----------------------------------------------------------------------
+
+void
+Trace::Exit()
+{
+    Append((TraceExitPage << 8) | (currentThread->getTid() << 1));
+}
+
+//----------------------------------------------------------------------
+// Trace::Append
+// 	Add a word to the buffer, writing the buffer out if it is full.
+//----------------------------------------------------------------------
+
+void
+Trace::Append(unsigned int word)
+{
+#ifdef HOST_THREADS
+    pthread_mutex_lock(&mutex);
+#endif
+    buffer[numBuffered++] = word;
+    if (numBuffered == TraceBufferSize)
+	Flush();
+#ifdef HOST_THREADS
+    pthread_mutex_unlock(&mutex);
+#endif
+}
+
+//----------------------------------------------------------------------
+// Trace::Flush
+// 	Write out the buffered references.
+//----------------------------------------------------------------------
+
+void
+Trace::Flush()
+{
+    WriteFile(file, (char *) buffer, numBuffered * sizeof(unsigned int));
+    numBuffered = 0;
+}
@@ -0,0 +1,77 @@
+// trace.h
+//	Data structures for recording the memory references of user
+//	programs.
+//
+//	With -trace, every user virtual address that is translated
+//	successfully -- instruction fetches as well as loads and stores --
+//	is logged as a reference to its page, by the thread making it.
+//	A reference that traps is logged once the kernel has handled the
+//	trap and the instruction is retried, so the trace is the same
+//	whatever the size of the TLB or of physical memory.
+//
+//	The trace is a binary file: a header (TraceHeader), then one
+//	32-bit word per reference, in host byte order:
+//
+//		bits 8-31	virtual page number
+//		bits 1-7	thread id
+//		bit 0		1 if the reference is a write
+//
+//	A virtual page number of TraceExitPage marks the end of a
+//	thread's address space; the thread id may be reused after it.
+//
+//	bin/replay reads the trace back and runs it against various TLB
+//	and page replacement policies, for any number of TLB entries and
+//	physical pages, much faster than re-running the programs.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "copyright.h"
+#include "utility.h"
+#ifdef HOST_THREADS
+#include <pthread.h>
+#endif
+
+#define TraceMagic	0x4e545243	// "NTRC"
+#define TraceExitPage	0xffffff	// the thread's address space is gone
+#define TraceBufferSize	8192		// references buffered before writing
+
+// The start of a trace file.  The sizes are those of the machine that
+// recorded the trace, for bin/replay to use by default.
+
+typedef struct {
+    int magic;				// TraceMagic
+    int pageSize;			// PageSize
+    int numPhysPages;			// NumPhysPages
+    int tlbSize;			// TLBSize, or 0 if no TLB
+} TraceHeader;
+
+// The following class defines a trace being recorded.
+
+class Trace {
+  public:
+    Trace(char *name);			// Start recording to file "name"
+    ~Trace();				// Flush the trace and close it
+
+    void Record(int vpn, bool writing);	// The current thread referred
+					// to page "vpn"
+    void Exit();			// The current thread's address
+					// space is being de-allocated
+
+  private:
+    void Append(unsigned int word);	// Buffer a reference
+    void Flush();			// Write out the buffered references
+
+    int file;				// where the trace goes
+    unsigned int buffer[TraceBufferSize];	// references not yet written
+    int numBuffered;			// how many are in buffer
+#ifdef HOST_THREADS
+    pthread_mutex_t mutex;		// CPUs run user code at the same time
+#endif
+};
+
+#endif // TRACE_H
@@ -93,10 +93,12 @@ Machine::ReadMem(int addr, int size, int *value)
     
     DEBUG('a', "Reading VA 0x%x, size %d\n", addr, size);
     
-    exception = Translate(addr, &physicalAddress, size, FALSE);
-    if (exception != NoException) {
-	machine->RaiseException(exception, addr);
-	return FALSE;
+    if (!SoftTranslate(addr, &physicalAddress, size, FALSE)) {
+	exception = Translate(addr, &physicalAddress, size, FALSE);
+	if (exception != NoException) {
+	    machine->RaiseException(exception, addr);
+	    return FALSE;
+	}
     }
 
     switch (size) {
@@ -143,10 +145,12 @@ Machine::WriteMem(int addr, int size, int value)
      
     DEBUG('a', "Writing VA 0x%x, size %d, value 0x%x\n", addr, size, value);
 
-    exception = Translate(addr, &physicalAddress, size, TRUE);
-    if (exception != NoException) {
-	machine->RaiseException(exception, addr);
-	return FALSE;
+    if (!SoftTranslate(addr, &physicalAddress, size, TRUE)) {
+	exception = Translate(addr, &physicalAddress, size, TRUE);
+	if (exception != NoException) {
+	    machine->RaiseException(exception, addr);
+	    return FALSE;
+	}
     }
     switch (size) {
       case 1:
@@ -165,6 +169,7 @@ Machine::WriteMem(int addr, int size, int value)
 	
       default: ASSERT(FALSE);
     }
+    decodeValid[physicalAddress / 4] = FALSE;	// it may have been code
     
     return TRUE;
 }
@@ -190,6 +195,7 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
     int i;
     unsigned int vpn, offset;
     TranslationEntry *entry;
+    SoftTLBEntry *soft;
     unsigned int pageFrame;
 
     DEBUG('a', "\tTranslate 0x%x, %s: ", virtAddr, writing ? "write" : "read");
@@ -210,27 +216,25 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
     offset = (unsigned) virtAddr % PageSize;
     
     if (tlb == NULL) {		// => page table => vpn is index into table
-        for(i = 0; i < pageTableSize; ++i)
-            pageTable[i].lrutime++;
 	if (vpn >= pageTableSize) {
 	    DEBUG('a', "virtual page # %d too large for page table size %d!\n", 
 			virtAddr, pageTableSize);
 	    return AddressErrorException;
-	} else if (!pageTable[vpn].valid) {
-	    DEBUG('a', "virtual page # %d too large for page table size %d!\n", 
-			virtAddr, pageTableSize);
+	}
+	entry = pageTable->Lookup(vpn);
+	if (entry == NULL || !entry->valid) {
+	    DEBUG('a', "virtual page # %d not in memory!\n", vpn);
 	    return PageFaultException;
 	}
-	entry = &pageTable[vpn];
-    entry->lrutime = 0;
+	entry->lrutime = NextLRUTime();
     } else {
     	tlbinfo.time++;
-    	for(i = 0; i < TLBSize; ++i)
-    		tlb[i].lrutime++;
-        for (entry = NULL, i = 0; i < TLBSize; i++)
-    	    if (tlb[i].valid && (tlb[i].virtualPage == vpn)) {
+	int first = TLBSet(vpn);		// only its set can hold it
+        for (entry = NULL, i = first; i < first + TLBWays; i++)
+    	    if (tlb[i].valid && (tlb[i].virtualPage == (int) vpn)
+			&& tlb[i].asid == asid) {
 		entry = &tlb[i];			// FOUND!
-		entry->lrutime = 0;
+		entry->lrutime = NextLRUTime();
 		break;
 	    }
 	if (entry == NULL) {				// not found
@@ -250,15 +254,177 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
 
     // if the pageFrame is too big, there is something really wrong! 
     // An invalid translation was loaded into the page table or TLB. 
-    if (pageFrame >= NumPhysPages) { 
+    if (pageFrame >= (unsigned) NumPhysPages) { 
 	DEBUG('a', "*** frame %d > %d!\n", pageFrame, NumPhysPages);
 	return BusErrorException;
     }
     entry->use = TRUE;		// set the use, dirty bits
     if (writing)
 	entry->dirty = TRUE;
+    if (trace != NULL)
+	trace->Record(vpn, writing);
     *physAddr = pageFrame * PageSize + offset;
+
+    soft = &softTLB[vpn % SoftTLBSize];	// remember it for next time
+    soft->virtualPage = vpn;
+    soft->entry = entry;
+    soft->host = &mainMemory[pageFrame * PageSize];
+    soft->writable = !entry->readOnly;
     ASSERT((*physAddr >= 0) && ((*physAddr + size) <= MemorySize));
     DEBUG('a', "phys addr = 0x%x\n", *physAddr);
     return NoException;
 }
+
+//----------------------------------------------------------------------
+// Machine::SoftTranslate
+// 	Translate a virtual address using only the soft TLB, a small
+//	direct-mapped cache of the translations recently done by Translate.
+//	On a hit, the effect is the same as calling Translate, but without
+//	searching the TLB or re-checking the page table entry.
+//
+//	Returns FALSE on a miss, or if Translate must be called anyway to
+//	raise an exception (misaligned address, write to a read-only page).
+//
+//	The soft TLB holds pointers into the page table and the TLB, so it
+//	must be flushed (FlushSoftTLB) whenever the kernel changes either.
+//----------------------------------------------------------------------
+
+bool
+Machine::SoftTranslate(int virtAddr, int* physAddr, int size, bool writing)
+{
+    unsigned int vpn = (unsigned) virtAddr / PageSize;
+    SoftTLBEntry *soft = &softTLB[vpn % SoftTLBSize];
+
+    if (soft->virtualPage != (int) vpn || (virtAddr & (size - 1)) != 0
+		|| (writing && !soft->writable))
+	return FALSE;
+    Touch(soft->entry, writing);
+    *physAddr = (soft->host - mainMemory) + (unsigned) virtAddr % PageSize;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Machine::FlushSoftTLB
+// 	Forget every translation in the soft TLB.
+//----------------------------------------------------------------------
+
+void
+Machine::FlushSoftTLB()
+{
+    for (int i = 0; i < SoftTLBSize; i++)
+	softTLB[i].virtualPage = -1;
+}
+
+//----------------------------------------------------------------------
+// Machine::FetchEntry
+// 	Return the page table or TLB entry that Translate used for
+//	"virtAddr", which must just have been translated successfully.
+//----------------------------------------------------------------------
+
+TranslationEntry *
+Machine::FetchEntry(int virtAddr)
+{
+    unsigned int vpn = (unsigned) virtAddr / PageSize;
+
+    int first;
+
+    if (tlb == NULL)
+	return pageTable->Lookup(vpn);
+    first = TLBSet(vpn);
+    for (int i = first; i < first + TLBWays; i++)
+	if (tlb[i].valid && tlb[i].virtualPage == (int) vpn
+		&& tlb[i].asid == asid)
+	    return &tlb[i];
+    ASSERT(FALSE);
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// Machine::TLBSet
+// 	Return the index in the TLB of the first entry of the set that
+//	may hold virtual page "vpn" of the address space running.  The
+//	set's TLBWays entries follow it.
+//----------------------------------------------------------------------
+
+int
+Machine::TLBSet(int vpn)
+{
+    return ((unsigned) (vpn ^ (asid * ASIDHash)) % TLBSets) * TLBWays;
+}
+
+//----------------------------------------------------------------------
+// Machine::WriteBackTLB
+// 	Bring the page table of an address space up to date with what
+//	every TLB of this Machine knows about its pages: which have been
+//	written to, which referred to since the last time we looked, and
+//	when each was last referred to.
+//
+//	"id" -- the address space's ID
+//	"table" -- its page table
+//----------------------------------------------------------------------
+
+void
+Machine::WriteBackTLB(int id, PageTable *table)
+{
+    for (int cpu = 0; cpu < TLBsPerMachine; cpu++)
+	for (int i = 0; i < TLBSize; i++) {
+	    TranslationEntry *entry = &cpuTLB[cpu][i];
+	    TranslationEntry *page;
+
+	    if (entry->valid && entry->asid == id
+		    && (page = table->Lookup(entry->virtualPage)) != NULL) {
+		page->lrutime = entry->lrutime;
+		if (entry->dirty)
+		    page->dirty = TRUE;
+		if (entry->use) {
+		    page->use = TRUE;
+		    entry->use = FALSE;
+		}
+	    }
+	}
+}
+
+//----------------------------------------------------------------------
+// Machine::InvalidateTLB
+// 	Drop the entries of an address space from every TLB of this
+//	Machine: those for one page, or all of them.
+//
+//	"id" -- the address space's ID
+//	"vpn" -- the virtual page, or -1 for every page
+//----------------------------------------------------------------------
+
+void
+Machine::InvalidateTLB(int id, int vpn)
+{
+    for (int cpu = 0; cpu < TLBsPerMachine; cpu++)
+	for (int i = 0; i < TLBSize; i++) {
+	    TranslationEntry *entry = &cpuTLB[cpu][i];
+
+	    if (entry->valid && entry->asid == id
+			&& (vpn == -1 || entry->virtualPage == vpn))
+		entry->valid = FALSE;
+	}
+    if (id == asid)			// the soft TLB may point at them
+	FlushSoftTLB();
+}
+
+//----------------------------------------------------------------------
+// Machine::Touch
+// 	Do the bookkeeping of Translate for a reference through "entry",
+//	which Translate has already found for the same page: stamp it with
+//	the time of reference, and set the use bit (and the dirty bit if
+//	"writing").
+//----------------------------------------------------------------------
+
+void
+Machine::Touch(TranslationEntry *entry, bool writing)
+{
+    if (tlb != NULL)
+	tlbinfo.time++;
+    entry->lrutime = NextLRUTime();
+    entry->use = TRUE;
+    if (writing)
+	entry->dirty = TRUE;
+    if (trace != NULL)
+	trace->Record(entry->virtualPage, writing);
+}
@@ -40,7 +40,11 @@ class TranslationEntry {
 			// page is referenced or modified.
     bool dirty;         // This bit is set by the hardware every time the
 			// page is modified.
-    int lrutime;
+    int lrutime;	// Value of Machine::lruClock when the page was last
+			// referenced through this entry; the entry with the
+			// smallest lrutime is the least recently used.
+    int asid;		// In a TLB, the address space the entry belongs to;
+			// it only matches when machine->asid is the same.
 };
 
 #endif
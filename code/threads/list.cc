@@ -242,6 +242,28 @@ List::SortedRemove(int *keyPtr)
     return thing;
 }
 
+//----------------------------------------------------------------------
+// List::SortedFirst
+//      Return the first "item" of a sorted list, without removing it.
+// 
+// Returns:
+//	Pointer to the first item, NULL if nothing on the list.
+//	Sets *keyPtr to the priority value of that item.
+//
+//	"keyPtr" is a pointer to the location in which to store the 
+//		priority of the item.
+//----------------------------------------------------------------------
+
+void *
+List::SortedFirst(int *keyPtr)
+{
+    if (IsEmpty()) 
+	return NULL;
+    if (keyPtr != NULL)
+        *keyPtr = first->key;
+    return first->item;
+}
+
 
 
 void
@@ -9,7 +9,15 @@
 // 	Most of this file is not needed until later assignments.
 //
 // Usage: nachos -d <debugflags> -rs <random seed #>
-//		-s -x <nachos file> -c <consoleIn> <consoleOut>
+//		-record <input log> -replay <input log>
+//		-s -ncpu <#cpus> -lockstep -prof <profile file>
+//		-pagesize <bytes> -physpages <#pages> -tlbsize <#entries>
+//		-tlbways <#entries> -pt <linear|twolevel|inverted>
+//		-swapsize <#pages> -replace <lru|clock|wsclock|lru2|arc>
+//		-prefetch <#pages> -pager <#frames> <#frames>
+//		-trace <trace file> -checkpoint <time> <checkpoint file>
+//		-restore <checkpoint file>
+//		-x <nachos file>[,<nachos file>...] -c <consoleIn> <consoleOut>
 //		-f -cp <unix file> <nachos file>
 //		-p <nachos file> -r <nachos file> -l -D -t
 //              -n <network reliability> -m <machine id>
@@ -18,11 +26,42 @@
 //
 //    -d causes certain debugging messages to be printed (cf. utility.h)
 //    -rs causes Yield to occur at random (but repeatable) spots
+//    -record logs the random numbers, console input and network packets
+//	the run gets, with when it gets them, to the named file
+//    -replay takes them from a log written by -record instead, so that
+//	the run (given the same flags) repeats the recorded one exactly
 //    -z prints the copyright message
 //
 //  USER_PROGRAM
 //    -s causes user programs to be executed in single-step mode
-//    -x runs a user program
+//    -ncpu simulates a multiprocessor with that many CPUs
+//    -lockstep runs the CPUs in a repeatable order (HOST_THREADS only)
+//    -pagesize, -physpages and -tlbsize set the size of a page (a power
+//	of 2), of physical memory in pages, and of the TLB
+//    -tlbways makes the TLB set-associative, with that many entries in
+//	each set (by default, it is fully associative)
+//    -pt chooses how page tables are laid out: a linear array (the
+//	default), two levels, or one inverted table of physical pages.
+//	The stack is at the top of a large address space, and the
+//	program at the bottom, so a linear table is mostly unused
+//    -swapsize sets how many pages the swap file holds (by default,
+//	4096, or on the Nachos file system half the free space on disk)
+//    -replace chooses the page replacement policy: least recently used
+//	(the default), clock, working set clock, LRU-2 or adaptive (ARC);
+//	see userprog/replacement.h
+//    -prefetch reads up to that many pages ahead when a program faults
+//	on its pages in order, into frames that are free (by default, 0)
+//    -pager starts a kernel thread that, once fewer than the first number
+//	of frames are free, replaces pages until the second number are;
+//	see userprog/pager.h
+//    -prof counts the user instructions run at each address, and writes
+//	the counts to the named file on halting (see bin/coffprof)
+//    -trace logs every page referred to by user programs to the named
+//	file (see bin/replay)
+//    -checkpoint saves the state of the machine and the user programs
+//	to the named file, at the first time slice at or after the time
+//    -restore resumes the run saved in a checkpoint file (instead of -x)
+//    -x runs a user program, or several at once, separated by commas
 //    -c tests the console
 //
 //  FILESYS
@@ -67,6 +106,8 @@ extern FileSystem  *fileSystem;
 extern void ThreadTest(void), Copy(char *unixFile, char *nachosFile);
 extern void Print(char *file), PerformanceTest(int), SynchConsoleTest(char *in, char *out);
 extern void StartProcess(char *file), ConsoleTest(char *in, char *out);
+extern void StartProcesses(char *files);
+extern void RestoreCheckpoint(char *file);
 extern void MailTest(int networkID);
 extern void ThreadStatus();
 
@@ -128,7 +169,11 @@ main(int argc, char **argv)
             //t1->Fork(StartProcess, *(argv + 1));
             //t2->Fork(StartProcess, *(argv + 1));
             //t3->Fork(StartProcess, *(argv + 1));
-            StartProcess(*(argv + 1));
+            StartProcesses(*(argv + 1));
+            argCount = 2;
+        } else if (!strcmp(*argv, "-restore")) {	// resume a checkpoint
+            ASSERT(argc > 1);
+            RestoreCheckpoint(*(argv + 1));
             argCount = 2;
         } else if (!strcmp(*argv, "-c")) {      // test the console
 	    if (argc == 1)
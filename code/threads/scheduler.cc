@@ -14,6 +14,17 @@
 //  Very simple implementation -- no priorities, straight FIFO.
 //  Might need to be improved in later assignments.
 //
+//  On a multiprocessor (-ncpu), each CPU has its own ready list.
+//  A thread goes back on the list of the CPU it last ran on, unless
+//  that CPU is much busier than another one; a CPU whose list is
+//  empty steals from the longest list.  The CPUs are simulated one
+//  after another on the single host thread; see NextCPU.
+//
+//  With HOST_THREADS, the CPUs run on host threads of their own, and
+//  these routines are called with the kernel lock held instead.  A
+//  thread that has started running a user program then stays on its
+//  CPU; see Bound.
+//
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
 // of liability and disclaimer of warranty provisions.
@@ -29,23 +40,28 @@
 
 Scheduler::Scheduler()
 {
-    readyList = new List;
+    for (int i = 0; i < MaxCPUs; i++)
+        readyList[i] = new List;
+    roundStart = roundEnd = 0;
 }
 
 //----------------------------------------------------------------------
 // Scheduler::~Scheduler
-//  De-allocate the list of ready threads.
+//  De-allocate the lists of ready threads.
 //----------------------------------------------------------------------
 
 Scheduler::~Scheduler()
 {
-    delete readyList;
+    for (int i = 0; i < MaxCPUs; i++)
+        delete readyList[i];
 }
 
 //----------------------------------------------------------------------
 // Scheduler::ReadyToRun
 //  Mark a thread as ready, but not running.
 //  Put it on the ready list, for later scheduling onto the CPU.
+//  That is the list of the CPU it last ran on, unless some other
+//  CPU has at least two fewer threads waiting.
 //
 //  "thread" is the thread to be put on the ready list.
 //----------------------------------------------------------------------
@@ -53,18 +69,37 @@ Scheduler::~Scheduler()
 void
 Scheduler::ReadyToRun (Thread *thread)
 {
+    int cpu = thread->getCPU();
+
     DEBUG('t', "Putting thread %s on ready list.\n", thread->getName());
 
+    if (!Bound(thread))
+        for (int i = 0; i < numCPUs; i++)
+            if (readyList[i]->NumInList() + 1 < readyList[cpu]->NumInList())
+                cpu = i;
+    thread->setCPU(cpu);
     thread->setStatus(READY);
-    readyList->SortedInsert((void *)thread, -thread->getPriority());
+    readyList[cpu]->SortedInsert((void *)thread, -thread->getPriority());
 
-    if(thread != currentThread && thread->getPriority() > currentThread->getPriority())
+#ifdef HOST_THREADS
+    if (cpus[cpu]->thread == NULL)      // wake up an idle CPU to run it
+        WakeCPU(cpu);
+    else if (!Bound(thread))
+        for (int i = 0; i < numCPUs; i++)
+            if (cpus[i]->thread == NULL) {
+                WakeCPU(i);
+                break;
+            }
+#endif
+
+    if(thread != currentThread && cpu == currentCPU->id
+       && thread->getPriority() > currentThread->getPriority())
         currentThread->Yield();
 }
 
 //----------------------------------------------------------------------
 // Scheduler::FindNextToRun
-//  Return the next thread to be scheduled onto the CPU.
+//  Return the next thread to be scheduled onto the current CPU.
 //  If there are no ready threads, return NULL.
 // Side effect:
 //  Thread is removed from the ready list.
@@ -73,7 +108,38 @@ Scheduler::ReadyToRun (Thread *thread)
 Thread *
 Scheduler::FindNextToRun ()
 {
-    return (Thread *)readyList->Remove();
+    return TakeReady(currentCPU->id);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::TakeReady
+//  Remove and return the first thread on the ready list of "cpu".
+//  If that list is empty, steal the first thread on the longest list
+//  instead, so that no CPU sits idle while there is work to do.
+//  If there are no ready threads at all, return NULL.
+//
+//  "cpu" is the CPU that is going to run the thread.
+//----------------------------------------------------------------------
+
+Thread *
+Scheduler::TakeReady (int cpu)
+{
+    Thread *thread = (Thread *)readyList[cpu]->Remove();
+    int victim = cpu;
+
+    if (thread == NULL && numCPUs > 1) {
+        for (int i = 0; i < numCPUs; i++)
+            if (readyList[i]->NumInList() > readyList[victim]->NumInList()
+                && !Bound((Thread *)readyList[i]->SortedFirst(NULL)))
+                victim = i;
+        thread = (Thread *)readyList[victim]->Remove();
+        if (thread != NULL)
+            DEBUG('t', "CPU %d steals thread \"%s\" from CPU %d\n",
+                  cpu, thread->getName(), victim);
+    }
+    if (thread != NULL)
+        thread->setCPU(cpu);
+    return thread;
 }
 
 //----------------------------------------------------------------------
@@ -107,6 +173,7 @@ Scheduler::Run (Thread *nextThread)
 
     currentThread = nextThread;         // switch to the next thread
     currentThread->setStatus(RUNNING);      // nextThread is now running
+    currentCPU->thread = nextThread;
 
     DEBUG('t', "Switching from thread \"%s\" to thread \"%s\"\n",
       oldThread->getName(), nextThread->getName());
@@ -137,14 +204,232 @@ Scheduler::Run (Thread *nextThread)
 #endif
 }
 
+#ifndef HOST_THREADS
+//----------------------------------------------------------------------
+// Scheduler::NextCPU
+//  Stop simulating the current CPU, and go on to the next one that
+//  has a thread to run.  Called when the current CPU has used up its
+//  turn (see Machine::CheckSlice), or has nothing left to do (see
+//  IdleCPU).  Returns when this thread is simulated again.
+//
+//  The CPUs are simulated in rounds, in order of their number.  Each
+//  busy CPU in a round starts its own clock from the time the round
+//  began, and runs until that time plus CPUQuantum; the next round
+//  begins at the latest time any of them reached.  Idle CPUs are
+//  handed any ready threads at the start of each round.
+//
+//  The machine's clock, stats->totalTicks, is the latest time any CPU
+//  has reached, so it never goes back; a CPU whose own clock is behind
+//  it does not move it on (see Interrupt::OneTick).  An interrupt
+//  fires on whichever CPU's turn first takes the machine's clock to
+//  the time it is due at.  Since the order never changes, the whole
+//  run is still deterministic.
+//----------------------------------------------------------------------
+
+void
+Scheduler::NextCPU()
+{
+    CPU *next = NULL;
+    int i;
+
+    ASSERT(interrupt->getLevel() == IntOff);
+
+    if (currentCPU->clock > roundEnd)
+        roundEnd = currentCPU->clock;
+    for (i = currentCPU->id + 1; i < numCPUs && next == NULL; i++)
+        if (cpus[i]->thread != NULL)
+            next = cpus[i];
+
+    if (next == NULL) {                 // the round is over
+        roundStart = roundEnd;
+        for (i = 0; i < numCPUs; i++) {
+            if (cpus[i]->thread == NULL
+                && (cpus[i]->thread = TakeReady(i)) != NULL)
+                cpus[i]->thread->setStatus(RUNNING);
+            if (cpus[i]->thread != NULL && next == NULL)
+                next = cpus[i];
+        }
+    }
+    ASSERT(next != NULL);
+
+    next->clock = roundStart;
+    next->sliceEnd = roundStart + CPUQuantum;
+    Dispatch(next);
+}
+#endif // HOST_THREADS
+
+//----------------------------------------------------------------------
+// Scheduler::OtherCPUsBusy
+//  Return TRUE if any CPU but the current one is running a thread.
+//----------------------------------------------------------------------
+
+bool
+Scheduler::OtherCPUsBusy()
+{
+    for (int i = 0; i < numCPUs; i++)
+        if (cpus[i] != currentCPU && cpus[i]->thread != NULL)
+            return TRUE;
+    return FALSE;
+}
+
+#ifndef HOST_THREADS
+//----------------------------------------------------------------------
+// Scheduler::IdleCPU
+//  The current thread is going to sleep, and there is nothing else for
+//  the current CPU to run, but other CPUs are still busy.  Leave this
+//  CPU idle, and go on simulating the others.  Returns when the
+//  thread has been woken up, and some CPU has picked it up again.
+//----------------------------------------------------------------------
+
+void
+Scheduler::IdleCPU()
+{
+    DEBUG('t', "CPU %d is idle\n", currentCPU->id);
+
+    currentCPU->thread = NULL;
+    NextCPU();
+}
+#else
+//----------------------------------------------------------------------
+// Scheduler::WaitForWork
+//  With the CPUs on host threads: the current thread is going to
+//  sleep, there is nothing else for this CPU to run, and other CPUs
+//  are busy.  Give up the kernel lock until ReadyToRun finds this CPU
+//  something to do.
+//
+//  Meanwhile the sleeping thread is still on this host thread's
+//  stack, so no other CPU may take it (see Bound).
+//----------------------------------------------------------------------
+
+void
+Scheduler::WaitForWork()
+{
+    DEBUG('t', "CPU %d is idle\n", currentCPU->id);
+
+    currentCPU->thread = NULL;
+    currentCPU->sleeper = currentThread;
+    kernelLock->Wait();
+    currentCPU->sleeper = NULL;
+    if (currentCPU->clock < stats->totalTicks)
+        currentCPU->clock = stats->totalTicks;  // time went on without us
+}
+
+//----------------------------------------------------------------------
+// Scheduler::WakeCPU
+//  Let "cpu", which is in WaitForWork, go and look for a thread to
+//  run.  It counts as busy from now on, so that no one else decides
+//  the whole machine is idle before it has had a look.
+//----------------------------------------------------------------------
+
+void
+Scheduler::WakeCPU(int cpu)
+{
+    cpus[cpu]->thread = cpus[cpu]->sleeper;
+    kernelLock->Wake(cpu);
+}
+#endif // HOST_THREADS
+
+//----------------------------------------------------------------------
+// Scheduler::Bound
+//  Return TRUE if "thread" must be run by the CPU it last ran on, and
+//  by no other.  Only so with HOST_THREADS, for a thread that is
+//  waiting in WaitForWork (it is still on that CPU's host thread), or
+//  that is running a user program (Machine::Run and the routines it
+//  calls are on its stack, working on that CPU's Machine).
+//----------------------------------------------------------------------
+
+bool
+Scheduler::Bound(Thread *thread)
+{
+#ifdef HOST_THREADS
+    return thread != NULL && (thread->space != NULL
+                              || cpus[thread->getCPU()]->sleeper == thread);
+#else
+    return FALSE;
+#endif
+}
+
+#ifndef HOST_THREADS
+//----------------------------------------------------------------------
+// Scheduler::Dispatch
+//  Start simulating CPU "to", by switching to the thread it is running.
+//  Much like Run, except that the old thread keeps its CPU: its status
+//  is unchanged, and its address space is only told to save its state
+//  if the CPU it leaves is idle.
+//----------------------------------------------------------------------
+
+void
+Scheduler::Dispatch (CPU *to)
+{
+    Thread *oldThread = currentThread;
+    Thread *nextThread = to->thread;
+
+    if (nextThread == oldThread)        // nothing else to simulate
+        return;
+
+#ifdef USER_PROGRAM
+    if (oldThread->space != NULL) {
+        oldThread->SaveUserState();
+        if (currentCPU->thread == NULL)
+            oldThread->space->SaveState();
+    }
+#endif
+
+    oldThread->CheckOverflow();
+
+    DEBUG('t', "Switching from CPU %d to CPU %d, thread \"%s\"\n",
+          currentCPU->id, to->id, nextThread->getName());
+
+    currentCPU = to;
+    currentThread = nextThread;
+#ifdef USER_PROGRAM
+    machine->SetCPU(to->id);
+#endif
+
+    SWITCH(oldThread, nextThread);
+
+    DEBUG('t', "Now in thread \"%s\" on CPU %d\n",
+          currentThread->getName(), currentCPU->id);
+
+    if (threadToBeDestroyed != NULL) {
+        delete threadToBeDestroyed;
+        threadToBeDestroyed = NULL;
+    }
+
+#ifdef USER_PROGRAM
+    if (currentThread->space != NULL) {
+        currentThread->RestoreUserState();
+        currentThread->space->RestoreState();
+    }
+#endif
+}
+#endif // HOST_THREADS
+
 //----------------------------------------------------------------------
 // Scheduler::Print
 //  Print the scheduler state -- in other words, the contents of
-//  the ready list.  For debugging.
+//  the ready lists.  For debugging.
 //----------------------------------------------------------------------
 void
 Scheduler::Print()
 {
-    printf("Ready list contents:\n");
-    readyList->Mapcar((VoidFunctionPtr) ThreadPrint);
+    for (int i = 0; i < numCPUs; i++) {
+        if (numCPUs > 1)
+            printf("CPU %d: ", i);
+        printf("Ready list contents:\n");
+        readyList[i]->Mapcar((VoidFunctionPtr) ThreadPrint);
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Apply
+//  Call "func" on each thread on the ready lists, CPU by CPU, in the
+//  order the threads would be run.
+//----------------------------------------------------------------------
+
+void
+Scheduler::Apply(VoidFunctionPtr func)
+{
+    for (int i = 0; i < numCPUs; i++)
+        readyList[i]->Mapcar(func);
 }
@@ -1,6 +1,6 @@
 // scheduler.h 
 //	Data structures for the thread dispatcher and scheduler.
-//	Primarily, the list of threads that are ready to run.
+//	Primarily, the lists of threads that are ready to run, one per CPU.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -12,6 +12,7 @@
 #include "copyright.h"
 #include "list.h"
 #include "thread.h"
+#include "cpu.h"
 
 // The following class defines the scheduler/dispatcher abstraction -- 
 // the data structures and operations needed to keep track of which 
@@ -19,18 +20,41 @@
 
 class Scheduler {
   public:
-    Scheduler();			// Initialize list of ready threads 
-    ~Scheduler();			// De-allocate ready list
+    Scheduler();			// Initialize lists of ready threads 
+    ~Scheduler();			// De-allocate ready lists
 
     void ReadyToRun(Thread* thread);	// Thread can be dispatched.
     Thread* FindNextToRun();		// Dequeue first thread on the ready 
 					// list, if any, and return thread.
     void Run(Thread* nextThread);	// Cause nextThread to start running
-    void Print();			// Print contents of ready list
+    void Print();			// Print contents of ready lists
+    void Apply(VoidFunctionPtr func);	// Call "func" on each ready thread
+
+    bool OtherCPUsBusy();		// Is any other CPU running a thread?
+#ifndef HOST_THREADS
+    void NextCPU();			// Move on to simulating the next CPU
+    void IdleCPU();			// Leave this CPU idle, and go and
+					// simulate another one
+#else
+    void WaitForWork();			// Leave this CPU idle until there
+					// is a thread for it to run
+#endif
     
   private:
-    List *readyList;  		// queue of threads that are ready to run,
-				// but not running
+    Thread* TakeReady(int cpu);		// Dequeue a thread for "cpu" to run,
+					// stealing one if its list is empty
+#ifndef HOST_THREADS
+    void Dispatch(CPU *to);		// Switch to simulating "to"
+#endif
+    bool Bound(Thread *thread);		// Must "thread" stay on its CPU?
+#ifdef HOST_THREADS
+    void WakeCPU(int cpu);		// End WaitForWork on "cpu"
+#endif
+
+    List *readyList[MaxCPUs];  	// queues of threads that are ready to 
+				// run, but not running, one per CPU
+    int roundStart;		// time the current round began
+    int roundEnd;		// latest time a CPU reached in this round
 };
 
 #endif // SCHEDULER_H
@@ -12,13 +12,24 @@
 // These are all initialized and de-allocated by this file.
 
 Thread *threadPtr[MaxThread];     // Pointers to all threads, NULL if not occupied
+#ifndef HOST_THREADS                // else they belong to the CPUs
 Thread *currentThread;          // the thread we are running now
-Thread *threadToBeDestroyed;        // the thread that just finished
+Thread *threadToBeDestroyed;    // the thread that just finished
+#endif
 Scheduler *scheduler;           // the ready list
 Interrupt *interrupt;           // interrupt status
 Statistics *stats;          // performance metrics
 Timer *timer;               // the hardware timer device,
                     // for invoking context switches
+int numCPUs = 1;            // how many CPUs the machine has
+CPU *cpus[MaxCPUs];         // the CPUs themselves
+#ifndef HOST_THREADS
+CPU *currentCPU;            // the CPU whose thread is currentThread
+#endif
+InputLog *inputLog;         // inputs to record or replay, if any
+#ifdef HOST_THREADS
+KernelLock *kernelLock;     // held by the CPU in the kernel
+#endif
 
 #ifdef FILESYS_NEEDED
 FileSystem  *fileSystem;
@@ -29,7 +40,19 @@ SynchDisk   *synchDisk;
 #endif
 
 #ifdef USER_PROGRAM // requires either FILESYS or FILESYS_STUB
-Machine *machine;   // user program memory and registers
+#ifndef HOST_THREADS
+Machine *machine;           // user program memory and registers
+#endif
+Profile *profile;           // user program profile, if -prof
+Trace *trace;               // user memory reference trace, if -trace
+Checkpoint *checkpoint;     // checkpoint to take, if -checkpoint
+PageTableKind pageTableKind = LinearTable;  // kind of page table, set by -pt
+ReplacementKind replacementKind = LRUReplacement;   // set by -replace
+int prefetchPages = 0;          // pages read ahead of a fault, set by
+                                // -prefetch
+CoreMap *coreMap;           // what each frame of memory holds
+Pager *pager;               // keeps frames free, if -pager
+SwapSpace *swapSpace;       // where pages not in memory are kept
 #endif
 
 #ifdef NETWORK
@@ -84,6 +107,12 @@ Initialize(int argc, char **argv)
 
 #ifdef USER_PROGRAM
     bool debugUserProg = FALSE; // single step user program
+    int numSwapPages = 0;       // size of the swap space, 0 for the default
+    int lowWater = 0, highWater = 0;    // free frames kept by the pager
+    char *traceFile = NULL;     // where to log memory references
+#ifdef HOST_THREADS
+    bool lockstep = FALSE;      // run the CPUs in a fixed order
+#endif
 #endif
 #ifdef FILESYS_NEEDED
     bool format = FALSE;    // format disk
@@ -109,10 +138,109 @@ Initialize(int argc, char **argv)
                         // number generator
         randomYield = TRUE;
         argCount = 2;
+    } else if (!strcmp(*argv, "-record")) {
+        ASSERT(argc > 1);
+        inputLog = new InputLog(*(argv + 1), FALSE);  // log the inputs
+        argCount = 2;
+    } else if (!strcmp(*argv, "-replay")) {
+        ASSERT(argc > 1);
+        inputLog = new InputLog(*(argv + 1), TRUE);   // take the inputs
+        argCount = 2;                               // from the log
     }
 #ifdef USER_PROGRAM
     if (!strcmp(*argv, "-s"))
         debugUserProg = TRUE;
+    else if (!strcmp(*argv, "-ncpu")) {
+        ASSERT(argc > 1);
+        numCPUs = atoi(*(argv + 1));    // simulate a multiprocessor
+        ASSERT(numCPUs >= 1 && numCPUs <= MaxCPUs);
+        argCount = 2;
+    }
+    else if (!strcmp(*argv, "-pagesize")) {
+        ASSERT(argc > 1);
+        PageSize = atoi(*(argv + 1));   // bytes in a page
+        ASSERT(PageSize >= 4 && (PageSize & (PageSize - 1)) == 0);
+        argCount = 2;
+    }
+    else if (!strcmp(*argv, "-physpages")) {
+        ASSERT(argc > 1);
+        NumPhysPages = atoi(*(argv + 1));   // size of physical memory
+        ASSERT(NumPhysPages >= 1);
+        argCount = 2;
+    }
+    else if (!strcmp(*argv, "-tlbsize")) {
+        ASSERT(argc > 1);
+        TLBSize = atoi(*(argv + 1));    // entries in each TLB
+        ASSERT(TLBSize >= 1);
+        argCount = 2;
+    }
+    else if (!strcmp(*argv, "-tlbways")) {
+        ASSERT(argc > 1);
+        TLBWays = atoi(*(argv + 1));    // entries in each set of a TLB
+        ASSERT(TLBWays >= 1);
+        argCount = 2;
+    }
+    else if (!strcmp(*argv, "-swapsize")) {
+        ASSERT(argc > 1);
+        numSwapPages = atoi(*(argv + 1));   // pages in the swap space
+        ASSERT(numSwapPages >= 1);
+        argCount = 2;
+    }
+    else if (!strcmp(*argv, "-pt")) {
+        ASSERT(argc > 1);
+        if (!strcmp(*(argv + 1), "twolevel"))
+            pageTableKind = TwoLevelTable;
+        else if (!strcmp(*(argv + 1), "inverted"))
+            pageTableKind = InvertedTable;
+        else
+            ASSERT(!strcmp(*(argv + 1), "linear"));
+        argCount = 2;
+    }
+    else if (!strcmp(*argv, "-replace")) {
+        ASSERT(argc > 1);
+        if (!strcmp(*(argv + 1), "clock"))
+            replacementKind = ClockReplacement;
+        else if (!strcmp(*(argv + 1), "wsclock"))
+            replacementKind = WSClockReplacement;
+        else if (!strcmp(*(argv + 1), "lru2"))
+            replacementKind = LRU2Replacement;
+        else if (!strcmp(*(argv + 1), "arc"))
+            replacementKind = ARCReplacement;
+        else
+            ASSERT(!strcmp(*(argv + 1), "lru"));
+        argCount = 2;
+    }
+    else if (!strcmp(*argv, "-prefetch")) {
+        ASSERT(argc > 1);
+        prefetchPages = atoi(*(argv + 1));  // pages read ahead of a fault
+        ASSERT(prefetchPages >= 0);
+        argCount = 2;
+    }
+    else if (!strcmp(*argv, "-pager")) {
+        ASSERT(argc > 2);
+        lowWater = atoi(*(argv + 1));   // frames the pager keeps free
+        highWater = atoi(*(argv + 2));
+        argCount = 3;
+    }
+    else if (!strcmp(*argv, "-prof")) {
+        ASSERT(argc > 1);
+        profile = new Profile(*(argv + 1)); // count user instructions
+        argCount = 2;
+    }
+    else if (!strcmp(*argv, "-trace")) {
+        ASSERT(argc > 1);
+        traceFile = *(argv + 1);    // log user memory references
+        argCount = 2;
+    }
+    else if (!strcmp(*argv, "-checkpoint")) {
+        ASSERT(argc > 2);           // save the state once it is time
+        checkpoint = new Checkpoint(*(argv + 2), atoi(*(argv + 1)));
+        argCount = 3;
+    }
+#ifdef HOST_THREADS
+    else if (!strcmp(*argv, "-lockstep"))
+        lockstep = TRUE;
+#endif
 #endif
 #ifdef FILESYS_NEEDED
     if (!strcmp(*argv, "-f"))
@@ -134,6 +262,13 @@ Initialize(int argc, char **argv)
     DebugInit(debugArgs);           // initialize DEBUG messages
     stats = new Statistics();           // collect statistics
     interrupt = new Interrupt;          // start up interrupt handling
+    for (int i = 0; i < numCPUs; i++)
+        cpus[i] = new CPU(i);
+#ifdef HOST_THREADS
+    cpus[0]->host = pthread_self();     // we are the first CPU
+#else
+    currentCPU = cpus[0];
+#endif
     scheduler = new Scheduler();        // initialize the ready queue
     if (randomYield)                // start the timer (if needed)
         timer = new Timer(TimerInterruptHandler, 0, randomYield);
@@ -146,12 +281,21 @@ Initialize(int argc, char **argv)
     // object to save its state. 
     currentThread = Thread::GenThread("main");     
     currentThread->setStatus(RUNNING);
+    currentCPU->thread = currentThread;
 
     interrupt->Enable();
     CallOnUserAbort(Cleanup);           // if user hits ctl-C
     
 #ifdef USER_PROGRAM
     machine = new Machine(debugUserProg);   // this must come first
+    if (traceFile != NULL)      // now that the geometry is known
+        trace = new Trace(traceFile);
+    coreMap = new CoreMap(NumPhysPages);
+#ifdef HOST_THREADS
+    kernelLock = new KernelLock(lockstep);  // held by us, for now
+#endif
+    if (lowWater > 0)
+        pager = new Pager(lowWater, highWater);
 #endif
 
 #ifdef FILESYS
@@ -162,9 +306,18 @@ Initialize(int argc, char **argv)
     fileSystem = new FileSystem(format);
 #endif
 
+#ifdef USER_PROGRAM
+    swapSpace = new SwapSpace(SwapFileName, numSwapPages);  // may be sized
+                                        // from the free disk sectors
+#endif
+
 #ifdef NETWORK
     postOffice = new PostOffice(netname, rely, 10);
 #endif
+
+#ifdef HOST_THREADS
+    StartCPUs(debugUserProg);       // this must come last
+#endif
 }
 
 //----------------------------------------------------------------------
@@ -180,10 +333,20 @@ Cleanup()
 #endif
     
 #ifdef USER_PROGRAM
+    if (profile != NULL) {
+        profile->Write();
+        delete profile;
+    }
+    delete trace;
     delete machine;
+    delete pager;
+    delete coreMap;
 #endif
 
 #ifdef FILESYS_NEEDED
+#ifdef USER_PROGRAM
+    delete swapSpace;           // removes the swap file
+#endif
     delete fileSystem;
 #endif
 
@@ -191,9 +354,12 @@ Cleanup()
     delete synchDisk;
 #endif
     
+    delete inputLog;
     delete timer;
     delete scheduler;
     delete interrupt;
+    for (int i = 0; i < numCPUs; i++)
+        delete cpus[i];
     
     Exit(0);
 }
@@ -15,6 +15,8 @@
 #include "interrupt.h"
 #include "stats.h"
 #include "timer.h"
+#include "cpu.h"
+#include "inputlog.h"
 
 #include "string.h"
 
@@ -27,17 +29,55 @@ extern void Cleanup();				// Cleanup, called when
 						// Nachos is done.
 
 extern Thread *threadPtr[MaxThread];     // Pointers to all threads, NULL if not occupied
-extern Thread *threadToBeDestroyed;  		// the thread that just finished
+#ifdef HOST_THREADS				// one of each per CPU (see cpu.h)
+#define threadToBeDestroyed	(currentCPU->toBeDestroyed)
+#define currentThread		(currentCPU->current)
+#else
+extern Thread *threadToBeDestroyed;		// the thread that just finished
 extern Thread *currentThread;			// the thread holding the CPU
+#endif
 extern Scheduler *scheduler;			// the ready list
 extern Interrupt *interrupt;			// interrupt status
 extern Statistics *stats;			// performance metrics
 extern Timer *timer;				// the hardware alarm clock
+extern int numCPUs;				// how many CPUs the machine has
+extern CPU *cpus[MaxCPUs];			// the CPUs themselves
+#ifdef HOST_THREADS
+#define currentCPU		(CurrentCPU())	// the CPU we are on
+#else
+extern CPU *currentCPU;				// the CPU being simulated
+#endif
+extern InputLog *inputLog;			// inputs to record or replay,
+						// if -record or -replay
+#ifdef HOST_THREADS
+extern KernelLock *kernelLock;			// held by the CPU in the kernel
+#endif
 
 #ifdef USER_PROGRAM
 #include "machine.h"
+#include "profile.h"
+#include "trace.h"
+#include "checkpoint.h"
+#include "coremap.h"
+#include "swapspace.h"
+#include "pager.h"
+#ifdef HOST_THREADS
+#define machine		(currentCPU->cpuMachine)
+#else
 extern Machine* machine;	// user program memory and registers
 #endif
+extern Profile *profile;	// user program profile, if -prof
+extern Trace *trace;		// user memory reference trace, if -trace
+extern Checkpoint *checkpoint;	// checkpoint to take, if -checkpoint
+extern PageTableKind pageTableKind;	// kind of page table, set by -pt
+extern ReplacementKind replacementKind;	// page replacement policy, set
+					// by -replace
+extern int prefetchPages;	// pages read ahead of a fault, set by
+				// -prefetch
+extern CoreMap *coreMap;	// what each frame of memory holds
+extern Pager *pager;		// keeps frames free, if -pager
+extern SwapSpace *swapSpace;	// where pages not in memory are kept
+#endif
 
 #ifdef FILESYS_NEEDED 		// FILESYS or FILESYS_STUB 
 #include "filesys.h"
@@ -63,6 +63,7 @@ Thread::Thread(char* threadName, int p)
         priority = 7;
     else
         priority = p;
+    cpu = currentCPU->id;       // start out where our parent is
     //allocate thread id
     uid = DefaultUid;
     for(int i = 0; i < MaxThread; ++i)
@@ -74,6 +75,7 @@ Thread::Thread(char* threadName, int p)
         }
 #ifdef USER_PROGRAM
     space = NULL;
+    restartable = FALSE;
 #endif
     //printf("thread %d is created!\n", tid);
 }
@@ -104,6 +106,26 @@ Thread::~Thread()
        DeallocBoundedArray((char *) stack, StackSize * sizeof(int));
 }
 
+//----------------------------------------------------------------------
+// Thread::setTid
+//  Change the thread's id to "t".  If another thread has that id, the
+//  two swap ids.
+//----------------------------------------------------------------------
+
+void
+Thread::setTid(int t)
+{
+    Thread *other = threadPtr[t];
+
+    if (other == this)
+        return;
+    threadPtr[tid] = other;
+    if (other != NULL)
+        other->tid = tid;
+    threadPtr[t] = this;
+    tid = t;
+}
+
 //----------------------------------------------------------------------
 // Thread::Fork
 //  Invoke (*func)(arg), allowing caller and callee to execute
@@ -237,7 +259,8 @@ Thread::Yield ()
 //  back on the ready queue, so that it can be re-scheduled.
 //
 //  NOTE: if there are no threads on the ready queue, that means
-//  we have no thread to run.  "Interrupt::Idle" is called
+//  we have no thread to run.  On a multiprocessor, this CPU is left
+//  idle if any other CPU is busy.  Otherwise, "Interrupt::Idle" is called
 //  to signify that we should idle the CPU until the next I/O interrupt
 //  occurs (the only thing that could cause a thread to become
 //  ready to run).
@@ -259,9 +282,26 @@ Thread::Sleep ()
     DEBUG('t', "Sleeping thread \"%s\"\n", getName());
 
     status = BLOCKED;
-    while ((nextThread = scheduler->FindNextToRun()) == NULL)
-    interrupt->Idle();  // no one to run, wait for an interrupt
+    while ((nextThread = scheduler->FindNextToRun()) == NULL) {
+        if (scheduler->OtherCPUsBusy()) {
+#ifdef HOST_THREADS
+            scheduler->WaitForWork();   // let the other CPUs go on
+            continue;
+#else
+            scheduler->IdleCPU();       // let the other CPUs go on; returns
+            return;                     // when we've been signalled
+#endif
+        }
+        interrupt->Idle();      // no one to run, wait for an interrupt
+    }
 
+#ifdef HOST_THREADS
+    if (nextThread == this) {   // we were signalled while waiting
+        status = RUNNING;
+        currentCPU->thread = this;
+        return;
+    }
+#endif
     scheduler->Run(nextThread); // returns when we've been signalled
 }
 
@@ -325,6 +365,8 @@ Thread::StackAllocate (VoidFunctionPtr func, void *arg)
 
 #ifdef USER_PROGRAM
 #include "machine.h"
+#include "checkpoint.h"
+#include "sysdep.h"
 
 //----------------------------------------------------------------------
 // Thread::SaveUserState
@@ -357,4 +399,49 @@ Thread::RestoreUserState()
     for (int i = 0; i < NumTotalRegs; i++)
         machine->WriteRegister(i, userRegisters[i]);
 }
+
+//----------------------------------------------------------------------
+// Thread::WriteBack
+//  Write the thread's identity, its user-level registers and its
+//  address space to the checkpoint file "fd".  The registers are
+//  those saved by SaveUserState.
+//----------------------------------------------------------------------
+
+void
+Thread::WriteBack(int fd)
+{
+    int ids[2];
+
+    ids[0] = tid;
+    ids[1] = priority;
+    WriteFile(fd, (char *) ids, sizeof(ids));
+    WriteString(fd, name);
+    WriteString(fd, fileName);
+    WriteFile(fd, (char *) &fileInfo, sizeof(fileInfo));
+    WriteFile(fd, (char *) userRegisters, sizeof(userRegisters));
+    space->WriteBack(fd);
+}
+
+//----------------------------------------------------------------------
+// Thread::FetchFrom
+//  Become the thread written by WriteBack to the checkpoint file "fd",
+//  taking over its thread id.  The registers are left for
+//  RestoreUserState to load into the machine.
+//----------------------------------------------------------------------
+
+void
+Thread::FetchFrom(int fd)
+{
+    int ids[2];
+
+    Read(fd, (char *) ids, sizeof(ids));
+    setTid(ids[0]);
+    priority = ids[1];
+    name = ReadString(fd);
+    fileName = ReadString(fd);
+    Read(fd, (char *) &fileInfo, sizeof(fileInfo));
+    Read(fd, (char *) userRegisters, sizeof(userRegisters));
+    space = new AddrSpace();
+    space->FetchFrom(fd);
+}
 #endif
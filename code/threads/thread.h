@@ -105,6 +105,9 @@ class Thread {
     int getTid() { return tid; }
     int getPriority() { return priority; }
     void setPriority(int p) { priority = p; }
+    int getCPU() { return cpu; }
+    void setCPU(int c) { cpu = c; }
+    void setTid(int t);         // Take over thread id "t"
     char* getStatus() {
         switch(status){
             case JUST_CREATED: return "just created";
@@ -123,6 +126,7 @@ class Thread {
     // Add uid & tid for Lab 1
     int uid, tid;
     int priority;
+    int cpu;                // CPU it is running on, or last ran on
     int* stack;             // Bottom of the stack
                     // NULL if this is the main thread
                     // (If NULL, don't deallocate stack)
@@ -160,8 +164,13 @@ class Thread {
     }
     void SaveUserState();       // save user-level register state
     void RestoreUserState();        // restore user-level register state
+    void WriteBack(int fd);     // write the thread out to a checkpoint
+    void FetchFrom(int fd);     // take on a thread read from a checkpoint
 
     AddrSpace *space;           // User code this thread is running.
+    bool restartable;           // TRUE while switched out at a point
+                    // where its user registers are all
+                    // there is to its state (see checkpoint.cc)
 #endif
 };
 
@@ -18,11 +18,36 @@
 #include "copyright.h"
 #include "system.h"
 #include "addrspace.h"
-#include "noff.h"
+#include "sysdep.h"
 #ifdef HOST_SPARC
 #include <strings.h>
 #endif
 
+// Address space IDs.  An ID is given to an address space the first time
+// it runs, and kept until the program exits; its entries stay in the
+// TLBs across context switches.  When the IDs run out, one is taken
+// from an address space that isn't running, which gets a new one when
+// it next runs.  Entries left in the TLBs under an ID are only flushed
+// when the ID is given out again.
+
+static AddrSpace *asidOwner[NumASIDs];	// address space with each ID
+
+//----------------------------------------------------------------------
+// TLBMachine
+// 	Return the Machine holding the TLB of CPU "cpu", or NULL if it
+//	holds none of its own (its TLB is in the first CPU's Machine).
+//----------------------------------------------------------------------
+
+static Machine *
+TLBMachine(int cpu)
+{
+#ifdef HOST_THREADS
+    return cpus[cpu]->cpuMachine;
+#else
+    return (cpu == 0) ? machine : NULL;
+#endif
+}
+
 //----------------------------------------------------------------------
 // SwapHeader
 // 	Do little endian to big endian conversion on the bytes in the 
@@ -45,6 +70,38 @@ SwapHeader (NoffHeader *noffH)
 	noffH->uninitData.inFileAddr = WordToHost(noffH->uninitData.inFileAddr);
 }
 
+//----------------------------------------------------------------------
+// InSegment
+// 	Return TRUE if any of a segment falls in virtual page "vpn".
+//----------------------------------------------------------------------
+
+static bool
+InSegment(Segment *segment, int vpn)
+{
+    return segment->size > 0
+	&& segment->virtualAddr < (vpn + 1) * PageSize
+	&& segment->virtualAddr + segment->size > vpn * PageSize;
+}
+
+//----------------------------------------------------------------------
+// LoadSegment
+// 	Copy the part of a segment of "executable" that falls in the "n"
+//	virtual pages starting at "vpn" (if any) into "pages", which holds
+//	those pages, with one read.
+//----------------------------------------------------------------------
+
+static void
+LoadSegment(OpenFile *executable, Segment *segment, int vpn, int n,
+	    char *pages)
+{
+    int start = max(segment->virtualAddr, vpn * PageSize),
+	end = min(segment->virtualAddr + segment->size, (vpn + n) * PageSize);
+
+    if (start < end)
+	executable->ReadAt(pages + start - vpn * PageSize, end - start,
+			   segment->inFileAddr + start - segment->virtualAddr);
+}
+
 //----------------------------------------------------------------------
 // AddrSpace::AddrSpace
 // 	Create an address space to run a user program.
@@ -53,50 +110,54 @@ SwapHeader (NoffHeader *noffH)
 //
 //	Assumes that the object code file is in NOFF format.
 //
-//	First, set up the translation from program memory to physical 
-//	memory.  For now, this is really simple (1:1), since we are
-//	only uniprogramming, and we have a single unsegmented page table
+//	Nothing is loaded yet: each page is read from the executable (or
+//	zeroed) the first time it is referred to, and is only given a
+//	slot in the swap space once it has been changed and is written
+//	out.  So the executable stays open, and belongs to the address
+//	space from now on.
+//
+//	The code and data are at the bottom of a virtual address space of
+//	UserVirtualPages pages, and the stack is at the top, with nothing
+//	in between; a reference to a page in between is an error.  Only
+//	the pages used have swap slots kept for them, and only a linear
+//	page table has entries for the pages in between.
 //
 //	"executable" is the file containing the object code to load into memory
+//	"name" is its name, for forked copies of the address space to
+//	open it by
 //----------------------------------------------------------------------
 
-AddrSpace::AddrSpace(OpenFile *executable)
+AddrSpace::AddrSpace(OpenFile *file, char *name)
 {
     NoffHeader noffH;
-    unsigned int i, size;
+    int i, size, stackPages;
 
+    asid = -1;
+    executable = file;
+    fileName = new char[strlen(name) + 1];
+    strcpy(fileName, name);
     executable->ReadAt((char *)&noffH, sizeof(noffH), 0);
     if ((noffH.noffMagic != NOFFMAGIC) && 
 		(WordToHost(noffH.noffMagic) == NOFFMAGIC))
     	SwapHeader(&noffH);
     ASSERT(noffH.noffMagic == NOFFMAGIC);
+    code = noffH.code;
+    initData = noffH.initData;
 
 // how big is address space?
-    size = noffH.code.size + noffH.initData.size + noffH.uninitData.size 
-			+ UserStackSize;	// we need to increase the size
-						// to leave room for the stack
-    numPages = divRoundUp(size, PageSize);
-    size = numPages * PageSize;
+    imagePages = divRoundUp(noffH.code.size + noffH.initData.size
+			    + noffH.uninitData.size, PageSize);
+    stackPages = divRoundUp(UserStackSize, PageSize);
+    numPages = max(UserVirtualPages, imagePages + stackPages);
+    stackBase = numPages - stackPages;
+    size = (imagePages + stackPages) * PageSize;
     printf("User program requires %d bytes\n", size);
 
     DEBUG('a', "Initializing address space, num pages %d, size %d\n", 
 					numPages, size);
-// first, set up the translation 
-    pageTable = new TranslationEntry[numPages];
-    for (i = 0; i < numPages; i++) {
-	//pageTable[i].virtualPage = i;	// for now, virtual page # = phys page #
-	//pageTable[i].physicalPage = i;
-	//pageTable[i].physicalPage = machine->bitmap->Find();
-    //ASSERT(pageTable[i].physicalPage != -1);
-    //printf("phys page %d allocated.\n", pageTable[i].physicalPage);
-    pageTable[i].lrutime = 0;
-    pageTable[i].valid = FALSE;
-	pageTable[i].use = FALSE;
-	pageTable[i].dirty = FALSE;
-	pageTable[i].readOnly = FALSE;  // if the code segment was entirely on 
-					// a separate page, we could set its 
-					// pages to be read-only
-    }
+// first, set up the translation; no page is in memory until it is
+// referred to
+    pageTable = NewPageTable(numPages);
     currentThread->fileInfo.size = size;
     currentThread->fileInfo.codeFAddr = noffH.code.inFileAddr;
     currentThread->fileInfo.initDataFAddr = noffH.initData.inFileAddr;
@@ -108,73 +169,15 @@ AddrSpace::AddrSpace(OpenFile *executable)
     currentThread->fileInfo.uninitDataBegin = noffH.uninitData.virtualAddr / PageSize;
     currentThread->fileInfo.uninitDataSize = noffH.uninitData.size;
 
-    printf("name: %s\n", currentThread->getFileName());
-    fileSystem->Create(currentThread->getFileName(), size);
-    OpenFile *openfile = fileSystem->Open(currentThread->getFileName());
-
-    char temp[PageSize];
-    if (noffH.code.size > 0) {
-        DEBUG('a', "Initializing code segment, at 0x%x, size %d\n", 
-            noffH.code.virtualAddr, noffH.code.size);
-        int addr = noffH.code.inFileAddr;
-        unsigned int vpn = (unsigned) noffH.code.virtualAddr / PageSize,
-                    offset = (unsigned) noffH.code.virtualAddr % PageSize,
-                    psize;
-        for(i = 0; i < noffH.code.size; i += PageSize){
-            psize = i + PageSize > noffH.code.size ? noffH.code.size - i:PageSize;
-            executable->ReadAt(temp, psize, addr);
-            openfile->WriteAt(temp, psize, vpn * PageSize + offset);
-            vpn++;
-            addr += PageSize;
-        }
-    }
-    if (noffH.initData.size > 0) {
-        DEBUG('a', "Initializing initData segment, at 0x%x, size %d\n", 
-            noffH.initData.virtualAddr, noffH.initData.size);
-        int addr = noffH.initData.inFileAddr;
-        unsigned int vpn = (unsigned) noffH.initData.virtualAddr / PageSize,
-                    offset = (unsigned) noffH.initData.virtualAddr % PageSize,
-                    psize;
-        for(i = 0; i < noffH.initData.size; i += PageSize){
-            psize = i + PageSize > noffH.initData.size ? noffH.initData.size - i:PageSize;
-            executable->ReadAt(temp, psize, addr);
-            openfile->WriteAt(temp, psize, vpn * PageSize + offset);
-            vpn++;
-            addr += PageSize;
-        }
-    }
-    /*
-    if (noffH.code.size > 0) {
-        DEBUG('a', "Initializing code segment, at 0x%x, size %d\n", 
-            noffH.code.virtualAddr, noffH.code.size);
-        int addr = noffH.code.inFileAddr;
-        unsigned int vpn = (unsigned) noffH.code.virtualAddr / PageSize,
-                    offset = (unsigned) noffH.code.virtualAddr % PageSize,
-                    physAddr, psize;
-        for(i = 0; i < noffH.code.size; i += PageSize){
-            physAddr = pageTable[vpn].physicalPage * PageSize + offset;
-            psize = i + PageSize > noffH.code.size ? noffH.code.size - i:PageSize;
-            executable->ReadAt(&(machine->mainMemory[physAddr]), psize, addr);
-            vpn++;
-            addr += PageSize;
-        }
-    }
-    if (noffH.initData.size > 0) {
-        DEBUG('a', "Initializing data segment, at 0x%x, size %d\n", 
-            noffH.initData.virtualAddr, noffH.initData.size);
-        int addr = noffH.initData.inFileAddr;
-        unsigned int vpn = (unsigned) noffH.initData.virtualAddr / PageSize,
-                    offset = (unsigned) noffH.initData.virtualAddr % PageSize,
-                    physAddr, psize;
-        for(i = 0; i < noffH.initData.size; i += PageSize){
-            physAddr = pageTable[vpn].physicalPage * PageSize + offset;
-            psize = i + PageSize > noffH.initData.size ? noffH.initData.size - i:PageSize;
-            executable->ReadAt(&(machine->mainMemory[physAddr]), psize, addr);
-            vpn++;
-            addr += PageSize;
-        }
+// and no page has a swap slot until it is written out
+    swapSlots = new int[NumUsed()];
+    prefetched = new bool[NumUsed()];
+    for (i = 0; i < NumUsed(); i++) {
+	swapSlots[i] = -1;
+	prefetched[i] = FALSE;
     }
-    */
+    nextFault = -1;
+
 // zero out the entire address space, to zero the unitialized data segment 
 // and the stack segment
 //    bzero(machine->mainMemory, size);
@@ -194,13 +197,100 @@ AddrSpace::AddrSpace(OpenFile *executable)
 //  }
 }
 
-AddrSpace::AddrSpace(const AddrSpace &space)
+//----------------------------------------------------------------------
+// AddrSpace::AddrSpace
+// 	Create a copy of address space "space", for a forked thread.
+//	Nothing is copied yet: the copy shares the original's pages,
+//	copy-on-write.  Each page the original has in memory is mapped to
+//	the same frame in the copy, and each page it has in a swap slot
+//	shares the slot; both are marked read-only in both address
+//	spaces, and the first to write to such a page gets a copy of its
+//	own (CopyOnWrite).  Pages still as the executable has them are
+//	read from it, by each address space for itself.
+//
+//	An inverted page table can't map a frame in two address spaces,
+//	so with one the pages in memory are shared through the swap space
+//	instead: those that have been changed are written out first.
+//
+//	The executable is opened before anything else, as that may wait
+//	for the disk, and let other threads run and change the original's
+//	pages while its page table is only partly walked.  The writes for
+//	an inverted table wait for the disk as well; each page written is
+//	read-only, and its frame busy, until it is out, so that the copy
+//	is the page as it was.
+//----------------------------------------------------------------------
+
+AddrSpace::AddrSpace(AddrSpace &space)
 {
+    TranslationEntry *entry, *copy;
+    int vpn, frame, slot;
+
+    fileName = new char[strlen(space.fileName) + 1];
+    strcpy(fileName, space.fileName);
+    executable = fileSystem->Open(fileName);
+    ASSERT(executable != NULL);
+    asid = -1;
     numPages = space.numPages;
-    pageTable = new TranslationEntry[numPages];
-    for (int i = 0; i < numPages; i++)
-        pageTable[i] = TranslationEntry(space.pageTable[i]);
+    imagePages = space.imagePages;
+    stackBase = space.stackBase;
+    code = space.code;
+    initData = space.initData;
+    pageTable = NewPageTable(numPages);
+    swapSlots = new int[NumUsed()];
+    prefetched = new bool[NumUsed()];
+    nextFault = -1;
+    space.SyncTLB();
+    for (int i = 0; i < NumUsed(); i++) {
+	vpn = PageAt(i);
+	prefetched[i] = FALSE;
+	swapSlots[i] = space.swapSlots[i];
+	if (swapSlots[i] != -1)
+	    swapSpace->Share(swapSlots[i]);
+	entry = space.pageTable->Lookup(vpn);
+	if (entry == NULL || !entry->valid)
+	    continue;
+	if (pageTableKind != InvertedTable) {
+	    copy = pageTable->Map(vpn, entry->physicalPage);
+	    copy->dirty = entry->dirty;
+	    copy->lrutime = entry->lrutime;
+	    copy->readOnly = TRUE;
+	    coreMap->Share(entry->physicalPage, this, vpn);
+	} else if (entry->dirty) {
+	    space.EvictPage(vpn);
+	    entry->readOnly = TRUE;		// no changes under the write
+	    entry->dirty = FALSE;
+	    frame = entry->physicalPage;
+	    coreMap->Busy(frame);
+	    slot = space.SwapOut(vpn, frame);
+	    coreMap->Written(frame);
+	    ShareSlot(vpn, slot);
+	}
+	if (pageTableKind != InvertedTable || swapSlots[i] != -1) {
+	    space.EvictPage(vpn);		// reload it read-only
+	    entry->readOnly = TRUE;
+	}
+    }
 }
+
+//----------------------------------------------------------------------
+// AddrSpace::AddrSpace
+// 	Create an address space with no pages, to be filled in from a
+//	checkpoint by FetchFrom.
+//----------------------------------------------------------------------
+
+AddrSpace::AddrSpace()
+{
+    asid = -1;
+    numPages = 0;
+    imagePages = stackBase = 0;
+    pageTable = NULL;
+    swapSlots = NULL;
+    prefetched = NULL;
+    nextFault = -1;
+    fileName = NULL;
+    executable = NULL;
+}
+
 //----------------------------------------------------------------------
 // AddrSpace::~AddrSpace
 // 	Dealloate an address space.  Nothing for now!
@@ -208,7 +298,11 @@ AddrSpace::AddrSpace(const AddrSpace &space)
 
 AddrSpace::~AddrSpace()
 {
+   Release();
    delete pageTable;
+   delete [] swapSlots;
+   delete [] prefetched;
+   delete [] fileName;
 }
 
 //----------------------------------------------------------------------
@@ -248,13 +342,13 @@ AddrSpace::InitRegisters()
 // 	On a context switch, save any machine state, specific
 //	to this address space, that needs saving.
 //
-//	For now, nothing!
+//	The TLB entries are tagged with our address space ID, so they
+//	can stay; the next address space won't match them.
 //----------------------------------------------------------------------
 
 void AddrSpace::SaveState() 
 {
-    for (int i = 0; i < TLBSize; ++i)
-        machine->tlb[i].valid = FALSE;
+    machine->FlushSoftTLB();
 }
 
 //----------------------------------------------------------------------
@@ -262,11 +356,658 @@ void AddrSpace::SaveState()
 // 	On a context switch, restore the machine state so that
 //	this address space can run.
 //
-//      For now, tell the machine where to find the page table.
+//      For now, tell the machine where to find the page table, and
+//	which TLB entries are ours.
 //----------------------------------------------------------------------
 
 void AddrSpace::RestoreState() 
 {
+    if (asid == -1)
+	AllocateASID();
+    machine->asid = asid;
     machine->pageTable = pageTable;
     machine->pageTableSize = numPages;
+    machine->FlushSoftTLB();
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::WriteBack
+// 	Write the address space ID, the valid entries of the page table,
+//	the swap slot of each page, and where the executable is, out to
+//	the checkpoint file "fd".  The pages themselves are in the
+//	checkpoint's copy of main memory, or in the swap file, or still
+//	in the executable.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::WriteBack(int fd)
+{
+    TranslationEntry *entry;
+    int position = 0, numValid = 0;
+
+    WriteFile(fd, (char *) &asid, sizeof(asid));
+    WriteFile(fd, (char *) &numPages, sizeof(numPages));
+    WriteFile(fd, (char *) &imagePages, sizeof(imagePages));
+    WriteFile(fd, (char *) &stackBase, sizeof(stackBase));
+    while (pageTable->NextValid(&position) != NULL)
+	numValid++;
+    WriteFile(fd, (char *) &numValid, sizeof(numValid));
+    position = 0;
+    while ((entry = pageTable->NextValid(&position)) != NULL)
+	WriteFile(fd, (char *) entry, sizeof(TranslationEntry));
+    WriteFile(fd, (char *) swapSlots, NumUsed() * sizeof(int));
+    WriteString(fd, fileName);
+    WriteFile(fd, (char *) &code, sizeof(code));
+    WriteFile(fd, (char *) &initData, sizeof(initData));
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::FetchFrom
+// 	Read in a page table and swap slots written by WriteBack, open the
+//	executable again, and take back the address space ID its TLB
+//	entries are tagged with.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::FetchFrom(int fd)
+{
+    TranslationEntry entry;
+    int numValid;
+
+    Read(fd, (char *) &asid, sizeof(asid));
+    if (asid != -1)			// the TLBs still hold its entries
+	asidOwner[asid] = this;
+    Read(fd, (char *) &numPages, sizeof(numPages));
+    Read(fd, (char *) &imagePages, sizeof(imagePages));
+    Read(fd, (char *) &stackBase, sizeof(stackBase));
+    delete pageTable;
+    pageTable = NewPageTable(numPages);
+    Read(fd, (char *) &numValid, sizeof(numValid));
+    for (int i = 0; i < numValid; i++) {
+	Read(fd, (char *) &entry, sizeof(TranslationEntry));
+	*pageTable->Map(entry.virtualPage, entry.physicalPage) = entry;
+    }
+    delete [] swapSlots;
+    swapSlots = new int[NumUsed()];
+    Read(fd, (char *) swapSlots, NumUsed() * sizeof(int));
+    delete [] prefetched;
+    prefetched = new bool[NumUsed()];
+    for (int i = 0; i < NumUsed(); i++)
+	prefetched[i] = FALSE;
+    delete [] fileName;
+    fileName = ReadString(fd);
+    delete executable;
+    executable = fileSystem->Open(fileName);
+    ASSERT(executable != NULL);
+    Read(fd, (char *) &code, sizeof(code));
+    Read(fd, (char *) &initData, sizeof(initData));
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::MarkInUse
+// 	Claim the frames of the pages this address space has in memory in
+//	the core map, and the slots of its pages in the swap space, after
+//	FetchFrom.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::MarkInUse()
+{
+    TranslationEntry *entry;
+    int position = 0;
+
+    while ((entry = pageTable->NextValid(&position)) != NULL)
+	coreMap->Claim(entry->physicalPage, this, entry->virtualPage);
+    for (int i = 0; i < NumUsed(); i++)
+	if (swapSlots[i] != -1)
+	    swapSpace->Claim(swapSlots[i]);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::PageIn
+// 	Bring page "vpn" into memory from its swap slot -- or, if it has
+//	never been written out, from the executable -- and map it.
+//	Another page -- of any address space -- may be replaced to make
+//	room for it.  If the page is still being written out, or read in
+//	by another thread, wait for that first; in the second case, there
+//	is then nothing left to do.
+//
+//	If the fault is for the page after the last one brought in, the
+//	program is likely going through its pages in order, so up to
+//	prefetchPages (set by -prefetch) of the pages after it are brought
+//	in as well -- but only into free frames, and only up to the next
+//	page already in memory.  They are read along with the page
+//	faulted on, with one read for each run of them that is together
+//	in the swap space or the executable.  A page prefetched is left
+//	with no reference time, so that until it is used, least recently
+//	used replacement takes it first.
+//
+//	A page of code (IsText) is read-only.  If another address space
+//	running the same executable has it in memory, it is just mapped to
+//	the same frame, with nothing read.  That can't be done with an
+//	inverted page table, which can't map a frame in two address
+//	spaces.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::PageIn(int vpn)
+{
+    int *frames, frame, slot, n = 1;
+    TranslationEntry *entry;
+
+    stats->numPageFaults++;
+    coreMap->WaitForTransit(this, vpn);	// being written out, or read
+						// in by another thread
+    entry = pageTable->Lookup(vpn);
+    if (entry != NULL && entry->valid)
+	return;
+    if (IsText(vpn) && pageTableKind != InvertedTable
+	    && (frame = coreMap->FindText(this, vpn)) != -1) {
+	DEBUG('a', "Sharing page %d in frame %d\n", vpn, frame);
+	stats->numTextShares++;
+	entry = pageTable->Map(vpn, frame);
+	entry->lrutime = Machine::lruClock;
+	entry->readOnly = TRUE;
+	coreMap->Share(frame, this, vpn);
+	nextFault = vpn + 1;
+	return;
+    }
+    frames = new int[prefetchPages + 1];
+    frames[0] = coreMap->Allocate(this, vpn);
+    DEBUG('a', "Paging in page %d to frame %d\n", vpn, frames[0]);
+    if (vpn == nextFault)
+	for (; n <= prefetchPages && Holds(vpn + n); n++) {
+	    entry = pageTable->Lookup(vpn + n);
+	    if ((entry != NULL && entry->valid)
+		    || (IsText(vpn + n) && coreMap->FindText(this, vpn + n) != -1)
+		    || coreMap->InTransit(this, vpn + n))
+		break;
+	    if ((frames[n] = coreMap->AllocateFree(this, vpn + n)) == -1)
+		break;
+	}
+    Fill(vpn, frames, n);
+    for (int i = 0; i < n; i++) {
+	entry = pageTable->Map(vpn + i, frames[i]);
+	if (i == 0)
+	    entry->lrutime = Machine::lruClock;
+	else {
+	    prefetched[Index(vpn + i)] = TRUE;
+	    stats->numPrefetches++;
+	}
+	slot = swapSlots[Index(vpn + i)];
+	entry->readOnly = IsText(vpn + i)
+			  || (slot != -1 && swapSpace->Shared(slot));
+	coreMap->Mapped(frames[i]);
+    }
+    nextFault = vpn + n;
+    delete [] frames;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Fill
+// 	Read the "n" pages starting at "vpn" into physical pages "frames",
+//	each from its swap slot or, if it has never been written out,
+//	from the executable.  Each run of pages that is together in one
+//	or the other is read at once.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::Fill(int vpn, int *frames, int n)
+{
+    char *buffer = NULL, *into;
+    int i, j, k, slot;
+
+    for (i = 0; i < n; i = j) {
+	slot = swapSlots[Index(vpn + i)];
+	for (j = i + 1; j < n; j++)
+	    if (slot == -1 ? swapSlots[Index(vpn + j)] != -1
+			   : swapSlots[Index(vpn + j)] != slot + j - i)
+		break;
+	if (j - i == 1)
+	    into = &machine->mainMemory[frames[i] * PageSize];
+	else {
+	    if (buffer == NULL)
+		buffer = new char[n * PageSize];
+	    into = buffer;
+	}
+	if (slot != -1) {
+	    stats->numSwapReads += j - i;
+	    swapSpace->ReadPages(slot, j - i, into);
+	} else
+	    LoadPages(vpn + i, j - i, into);
+	for (k = i; k < j; k++) {
+	    if (j - i > 1)
+		bcopy(into + (k - i) * PageSize,
+		      &machine->mainMemory[frames[k] * PageSize], PageSize);
+	    machine->InvalidateDecodeCache(frames[k]);
+	}
+    }
+    delete [] buffer;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyOnWrite
+// 	Page "vpn", shared copy-on-write with another address space, is
+//	being written to.  If its frame is shared, give it a frame of its
+//	own, with a copy of the page; either way, let go of any swap slot
+//	it shares, as from now on its contents are its own.  The page is
+//	then writable, and dirty, as the only copy of it is in memory.
+//
+//	Another page -- of any address space -- may be replaced to make
+//	room for the copy, perhaps the very page being copied; in that
+//	case it is read back from the swap slot it was written to.  If
+//	the page is being written out for a forked address space, that
+//	is waited for first.
+//
+//	Returns FALSE if the page is code, which is read-only for good.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::CopyOnWrite(int vpn)
+{
+    TranslationEntry *entry;
+    int frame, copy;
+
+    if (IsText(vpn))
+	return FALSE;
+    coreMap->WaitForTransit(this, vpn);
+    entry = pageTable->Lookup(vpn);
+    if (entry == NULL || !entry->valid)
+	return TRUE;			// paged out; it will fault again
+    EvictPage(vpn);			// reload it once it is writable
+    if (!entry->readOnly)
+	return TRUE;
+    DEBUG('a', "Copy on write of page %d\n", vpn);
+    stats->numCopiesOnWrite++;
+    entry->use = TRUE;			// it is being referred to
+    if (coreMap->Sharers(entry->physicalPage) > 1) {
+	copy = coreMap->Allocate(this, vpn);
+	entry = pageTable->Lookup(vpn);
+	if (entry != NULL && entry->valid) {
+	    frame = entry->physicalPage;
+	    bcopy(&machine->mainMemory[frame * PageSize],
+		  &machine->mainMemory[copy * PageSize], PageSize);
+	    machine->InvalidateDecodeCache(copy);
+	    EvictPage(vpn);
+	    coreMap->Free(frame, this, vpn);
+	    Unmap(vpn);
+	} else
+	    Fill(vpn, &copy, 1);
+	entry = pageTable->Map(vpn, copy);
+	entry->lrutime = Machine::lruClock;
+	coreMap->Mapped(copy);
+    }
+    if (swapSlots[Index(vpn)] != -1) {
+	swapSpace->Free(swapSlots[Index(vpn)]);
+	swapSlots[Index(vpn)] = -1;
+    }
+    entry->readOnly = FALSE;
+    entry->dirty = TRUE;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::IsText
+// 	Return TRUE if page "vpn" holds nothing but code.  Such a page is
+//	never changed, so it is mapped read-only, and shared by all the
+//	address spaces running the same executable.  A page that is only
+//	partly code also holds data, and is private.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::IsText(int vpn)
+{
+    return vpn * PageSize >= code.virtualAddr
+	&& (vpn + 1) * PageSize <= code.virtualAddr + code.size;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Holds
+// 	Return TRUE if page "vpn" is one of the pages of code and data at
+//	the bottom of the address space, or of the stack at the top.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::Holds(int vpn)
+{
+    return vpn >= 0 && (vpn < imagePages
+			|| (vpn >= stackBase && vpn < (int) numPages));
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Index
+// 	Return where page "vpn", which we hold, is in swapSlots and
+//	prefetched: the pages of code and data come first, then those of
+//	the stack.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::Index(int vpn)
+{
+    ASSERT(Holds(vpn));
+    return (vpn < imagePages) ? vpn : imagePages + vpn - stackBase;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::PageAt
+// 	Return the page at "index" in swapSlots and prefetched.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::PageAt(int index)
+{
+    return (index < imagePages) ? index : stackBase + index - imagePages;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::SharesText
+// 	Return TRUE if page "vpn" of address space "space" is code that
+//	we can share: "space" is running the same executable.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::SharesText(AddrSpace *space, int vpn)
+{
+    return space != this && IsText(vpn)
+	&& executable != NULL && space->executable != NULL
+	&& !strcmp(fileName, space->fileName)
+	&& code.virtualAddr == space->code.virtualAddr
+	&& code.size == space->code.size
+	&& code.inFileAddr == space->code.inFileAddr;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::SwapSlot
+// 	Return the swap slot of page "vpn", giving it one if this is the
+//	first time it is written out.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::SwapSlot(int vpn)
+{
+    int *slot = &swapSlots[Index(vpn)];
+
+    if (*slot == -1)
+	*slot = swapSpace->Allocate();
+    return *slot;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::SwapOut
+// 	Write page "vpn", in physical page "frame", to its swap slot, and
+//	return the slot.  The caller has dropped the page from the TLBs.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::SwapOut(int vpn, int frame)
+{
+    int slot = SwapSlot(vpn);
+
+    stats->numPageOuts++;
+    swapSpace->WritePage(slot, &machine->mainMemory[frame * PageSize]);
+    return slot;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ShareSlot
+// 	Page "vpn", which shares a frame with a page of another address
+//	space, has just been written out with it, to swap slot "slot".
+//	Share the slot, unless the page already does.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::ShareSlot(int vpn, int slot)
+{
+    if (swapSlots[Index(vpn)] == -1) {
+	swapSlots[Index(vpn)] = slot;
+	swapSpace->Share(slot);
+    }
+    ASSERT(swapSlots[Index(vpn)] == slot);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::LoadPages
+// 	Fill "into" with the "n" pages starting at "vpn" as the program
+//	starts out: the parts of the code and initialized data segments
+//	that fall in them, read from the executable, and zeroes.  Pages
+//	of uninitialized data and stack hold nothing but zeroes, and are
+//	not read at all; like any other page, they only go to the swap
+//	space once they have been written to and are replaced.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::LoadPages(int vpn, int n, char *into)
+{
+    bzero(into, n * PageSize);
+    for (int i = vpn; i < vpn + n; i++)
+	if (InSegment(&code, i) || InSegment(&initData, i))
+	    stats->numExecutableReads++;
+	else
+	    stats->numZeroFills++;
+    LoadSegment(executable, &code, vpn, n, into);
+    LoadSegment(executable, &initData, vpn, n, into);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Unmap
+// 	Take page "vpn" out of the page table.  If it was prefetched,
+//	count whether it was used before it went.  The caller has brought
+//	the page table up to date with the TLBs.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::Unmap(int vpn)
+{
+    TranslationEntry *entry = pageTable->Lookup(vpn);
+
+    if (prefetched[Index(vpn)]) {
+	prefetched[Index(vpn)] = FALSE;
+	if (entry->lrutime != 0 || entry->use || entry->dirty)
+	    stats->numPrefetchHits++;
+    }
+    pageTable->Unmap(vpn);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Release
+// 	Give back the frames and swap slots of all our pages (those shared
+//	with another address space stay with it), and our address space
+//	ID, and close the executable, as the program has exited.  Pages
+//	still being written out are waited for, as the writes use their
+//	swap slots.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::Release()
+{
+    TranslationEntry *entry;
+    int position = 0;
+
+    coreMap->WaitForTransit(this, -1);	// let writes of its pages finish
+    if (pageTable != NULL) {
+	SyncTLB();
+	stats->maxPageTableBytes = max(stats->maxPageTableBytes,
+				       pageTable->Size());
+    }
+    while (pageTable != NULL
+	    && (entry = pageTable->NextValid(&position)) != NULL) {
+	if (coreMap->Free(entry->physicalPage, this, entry->virtualPage))
+	    printf("phys page %d deallocated.\n", entry->physicalPage);
+	Unmap(entry->virtualPage);
+    }
+    for (int i = 0; swapSlots != NULL && i < NumUsed(); i++)
+	if (swapSlots[i] != -1) {
+	    swapSpace->Free(swapSlots[i]);
+	    swapSlots[i] = -1;
+	}
+    coreMap->Forget(this);
+    ReleaseASID();
+    delete executable;
+    executable = NULL;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::SyncTLB
+// 	Copy the dirty bits and reference times of our pages from every
+//	TLB into the page table, so that the page table is up to date
+//	before choosing a page to replace, or writing one out.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::SyncTLB()
+{
+    Machine *m;
+
+    if (machine->tlb == NULL || asid == -1)
+	return;
+    for (int i = 0; i < numCPUs; i++)
+	if ((m = TLBMachine(i)) != NULL)
+	    m->WriteBackTLB(asid, pageTable);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::RunningElsewhere
+// 	Return TRUE if another CPU is running user code in this address
+//	space right now.  Only possible with HOST_THREADS, where the CPUs
+//	run user code while one of them is in the kernel; a CPU waiting
+//	to get into the kernel doesn't count, as it has finished with
+//	user memory until it gets in.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::RunningElsewhere()
+{
+#ifdef HOST_THREADS
+    for (int cpu = 0; cpu < numCPUs; cpu++)
+	if (cpus[cpu] != currentCPU && cpus[cpu]->inUserCode
+		&& cpus[cpu]->thread != NULL
+		&& cpus[cpu]->thread->space == this)
+	    return TRUE;
+#endif
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::SyncAllTLBs
+// 	Bring the page table of every address space with entries in the
+//	TLBs up to date, before choosing a page to replace from all of
+//	memory.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::SyncAllTLBs()
+{
+    for (int i = 0; i < NumASIDs; i++)
+	if (asidOwner[i] != NULL)
+	    asidOwner[i]->SyncTLB();
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::EvictPage
+// 	Drop page "vpn" from every TLB, as it is leaving memory, or its
+//	entry is changing.  Without TLBs, only the soft TLBs of the CPUs
+//	running this address space remember it.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::EvictPage(int vpn)
+{
+    Machine *m;
+
+    for (int i = 0; i < numCPUs; i++) {
+	if ((m = TLBMachine(i)) == NULL)
+	    continue;
+	if (machine->tlb == NULL) {
+	    if (m->pageTable == pageTable)
+		m->FlushSoftTLB();
+	} else if (asid != -1)
+	    m->InvalidateTLB(asid, vpn);
+    }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::WriteBackEntry
+// 	Save the dirty and use bits and reference time of a TLB entry
+//	that is about to be replaced in the page table of the address
+//	space it belongs to -- if that address space still has the
+//	entry's ID, and the page is still where the entry says.
+//
+//	"entry" -- the TLB entry
+//----------------------------------------------------------------------
+
+void
+AddrSpace::WriteBackEntry(TranslationEntry *entry)
+{
+    AddrSpace *owner = asidOwner[entry->asid];
+    TranslationEntry *page;
+
+    if (!entry->valid || owner == NULL)
+	return;
+    page = owner->pageTable->Lookup(entry->virtualPage);
+    if (page != NULL && page->valid
+	    && page->physicalPage == entry->physicalPage) {
+	if (entry->dirty)
+	    page->dirty = TRUE;
+	if (entry->use)
+	    page->use = TRUE;
+	page->lrutime = entry->lrutime;	// for the page replacement
+    }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ReleaseASID
+// 	Give up our address space ID.  Our entries are left in the TLBs,
+//	where nothing will match them, until the ID is given out again.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::ReleaseASID()
+{
+    if (asid != -1 && asidOwner[asid] == this)
+	asidOwner[asid] = NULL;
+    asid = -1;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AllocateASID
+// 	Give us an address space ID: a free one if there is one, or else
+//	the lowest one whose address space isn't running on any CPU.
+//	Either way, flush whatever is left in the TLBs under the ID,
+//	first saving what the TLBs know about its previous owner's pages.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::AllocateASID()
+{
+    int id;
+    AddrSpace *owner;
+    Machine *m;
+
+    for (id = 0; id < NumASIDs && asidOwner[id] != NULL; id++)
+	;
+    if (id == NumASIDs) {			// take one
+	for (id = 0; id < NumASIDs; id++) {
+	    int cpu;
+
+	    for (cpu = 0; cpu < numCPUs; cpu++)
+		if (cpus[cpu]->thread != NULL
+			&& cpus[cpu]->thread->space == asidOwner[id])
+		    break;
+	    if (cpu == numCPUs)
+		break;
+	}
+	ASSERT(id < NumASIDs);
+    }
+    owner = asidOwner[id];
+    if (owner != NULL) {
+	owner->SyncTLB();
+	owner->asid = -1;
+    }
+    if (machine->tlb != NULL)
+	for (int i = 0; i < numCPUs; i++)
+	    if ((m = TLBMachine(i)) != NULL)
+		m->InvalidateTLB(id, -1);
+    DEBUG('a', "Address space ID %d recycled\n", id);
+    asidOwner[id] = this;
+    asid = id;
 }
@@ -15,15 +15,25 @@
 
 #include "copyright.h"
 #include "filesys.h"
+#include "bitmap.h"
+#include "noff.h"
 
 #define UserStackSize		1024 	// increase this as necessary!
+#define UserVirtualPages	4096	// pages of virtual address space,
+					// unless the program needs more
 
 class AddrSpace {
   public:
-    AddrSpace(OpenFile *executable);	// Create an address space,
-					// initializing it with the program
-					// stored in the file "executable"
-    AddrSpace(const AddrSpace &space);
+    AddrSpace(OpenFile *executable, char *fileName);
+					// Create an address space for the
+					// program stored in the file
+					// "executable", which it keeps open
+					// to page code and data in from
+    AddrSpace(AddrSpace &space);	// Create a copy of "space" for a
+					// forked thread, sharing its pages
+					// copy-on-write
+    AddrSpace();			// Create an empty address space, for
+					// FetchFrom to fill in
     ~AddrSpace();			// De-allocate an address space
 
     void InitRegisters();		// Initialize user-level CPU registers,
@@ -32,11 +42,80 @@ class AddrSpace {
     void SaveState();			// Save/restore address space-specific
     void RestoreState();		// info on a context switch 
 
+    void WriteBack(int fd);		// Write/read the page table to/from
+    void FetchFrom(int fd);		// a checkpoint file
+    void MarkInUse();			// Claim its frames and swap slots
+
+    TranslationEntry *Lookup(int vpn) { return pageTable->Lookup(vpn); }
+    bool Holds(int vpn);		// Is page "vpn" part of the program
+					// or its stack?
+    void PageIn(int vpn);		// Bring page "vpn" into memory
+    bool CopyOnWrite(int vpn);		// Give page "vpn" a copy of its own
+					// that can be written, unless it is
+					// code
+    bool IsText(int vpn);		// Is page "vpn" all code?
+    bool SharesText(AddrSpace *space, int vpn);
+					// Can page "vpn" of "space" be
+					// shared with us?
+    int SwapSlot(int vpn);		// Page "vpn"'s swap slot, given one
+					// if need be
+    int SwapOut(int vpn, int frame);	// Write page "vpn" to its swap slot
+    void ShareSlot(int vpn, int slot);	// Page "vpn" shares swap slot "slot"
+    void Unmap(int vpn);		// Take page "vpn" out of the page
+					// table
+    void Release();			// Give back its frames, swap slots
+					// and address space ID, as the
+					// program has exited
+    bool RunningElsewhere();		// Is another CPU running it?
+
+    void SyncTLB();			// Copy what the TLBs know about its
+					// pages into the page table
+    void EvictPage(int vpn);		// Drop page "vpn" from the TLBs
+    void ReleaseASID();			// Give up its address space ID, as
+					// the program has exited
+    static void SyncAllTLBs();		// SyncTLB every address space that
+					// has entries in the TLBs
+    static void WriteBackEntry(TranslationEntry *entry);
+					// A TLB entry is being replaced;
+					// save its dirty bit and reference
+					// time in its page table
+
   private:
-    TranslationEntry *pageTable;	// Assume linear page table translation
-					// for now!
+    void AllocateASID();		// Find it an address space ID
+    void LoadPages(int vpn, int n, char *into);
+					// Read "n" pages from "vpn" on as
+					// the program starts out, from the
+					// executable
+    void Fill(int vpn, int *frames, int n);
+					// Read "n" pages from "vpn" on into
+					// "frames"
+    int Index(int vpn);			// Where page "vpn" is in swapSlots
+					// and prefetched
+    int PageAt(int index);		// The page at "index" in them
+    int NumUsed() { return imagePages + numPages - stackBase; }
+					// Pages of the program and stack
+
+    PageTable *pageTable;		// Translation of its pages, of the
+					// kind chosen with -pt
     unsigned int numPages;		// Number of pages in the virtual 
 					// address space
+    int imagePages;			// pages of code and data, at the
+					// bottom of the address space
+    int stackBase;			// first page of the stack, at the
+					// top; the pages in between are
+					// never used
+    int asid;				// ID its TLB entries are tagged
+					// with, or -1 if it has none
+    int *swapSlots;			// swap slot of each page used (see
+					// Index), or -1 if it has never
+					// been written out
+    bool *prefetched;			// is each page used in memory only
+					// because it was prefetched?
+    int nextFault;			// the page after the last ones
+					// brought in
+    char *fileName;			// the executable, and the segments
+    OpenFile *executable;		// in it that pages not yet written
+    Segment code, initData;		// out are read from
 };
 
 #endif // ADDRSPACE_H
@@ -0,0 +1,317 @@
+// checkpoint.cc
+//	Routines to write the state of the machine and of the user
+//	programs to a checkpoint file, and to resume a run from one.
+//
+//	The checkpoint file is binary, in the host's byte order:
+//
+//		a header: magic number, PageSize, NumPhysPages, TLBSize
+//			(0 if no TLB), NumTotalRegs, TLBWays
+//		the statistics, and when the next timer interrupt is due
+//		the machine: LRU clock, TLB counts, TLB, main memory
+//		the number of threads, then each thread (Thread::WriteBack):
+//			first the one running, then the ready list in order
+//		the file backing the threads' memory: the DISK, with
+//			FILESYS, or else the swap file; as its name, its
+//			length, and its contents
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "checkpoint.h"
+#include "system.h"
+#include "sysdep.h"
+
+#define NumHeaderWords	6
+
+static int checkpointFile;		// for WriteThread
+static int numWritten;			// threads WriteThread has written
+
+//----------------------------------------------------------------------
+// WriteString, ReadString
+// 	Write a string to a checkpoint file, and read one back in (into
+//	memory that is never de-allocated, as the strings are names).
+//----------------------------------------------------------------------
+
+void
+WriteString(int fd, char *str)
+{
+    int len = strlen(str);
+
+    WriteFile(fd, (char *) &len, sizeof(len));
+    WriteFile(fd, str, len);
+}
+
+char *
+ReadString(int fd)
+{
+    int len;
+    char *str;
+
+    Read(fd, (char *) &len, sizeof(len));
+    str = new char[len + 1];
+    Read(fd, str, len);
+    str[len] = '\0';
+    return str;
+}
+
+//----------------------------------------------------------------------
+// WriteHostFile, ReadHostFile
+// 	Copy a UNIX file into a checkpoint file, and back out again.
+//----------------------------------------------------------------------
+
+static void
+WriteHostFile(int fd, char *name)
+{
+    int file = OpenForReadWrite(name, TRUE);
+    int len;
+    char *contents;
+
+    Lseek(file, 0, 2);
+    len = Tell(file);
+    Lseek(file, 0, 0);
+    contents = new char[len];
+    Read(file, contents, len);
+    Close(file);
+
+    WriteString(fd, name);
+    WriteFile(fd, (char *) &len, sizeof(len));
+    WriteFile(fd, contents, len);
+    delete [] contents;
+}
+
+static void
+ReadHostFile(int fd)
+{
+    char *name = ReadString(fd);
+    int len, file;
+    char *contents;
+
+    Read(fd, (char *) &len, sizeof(len));
+    contents = new char[len];
+    Read(fd, contents, len);
+
+    file = OpenForWrite(name);
+    WriteFile(file, contents, len);
+    Close(file);
+    delete [] contents;
+}
+
+//----------------------------------------------------------------------
+// WriteThread
+// 	Write a ready thread to the checkpoint.  Called through
+//	Scheduler::Apply.
+//----------------------------------------------------------------------
+
+static void
+WriteThread(int arg)
+{
+    Thread *thread = (Thread *) arg;
+
+    thread->WriteBack(checkpointFile);
+    numWritten++;
+}
+
+//----------------------------------------------------------------------
+// ResumeProcess
+// 	Start running a thread restored from a checkpoint, where it was
+//	switched out.  Its address space is only attached now, so that
+//	a context switch before this point doesn't save the wrong user
+//	registers over its own.
+//
+//	"arg" -- the thread's address space
+//----------------------------------------------------------------------
+
+static void
+ResumeProcess(int arg)
+{
+    currentThread->space = (AddrSpace *) arg;
+    currentThread->RestoreUserState();
+    currentThread->space->RestoreState();
+    machine->Run();
+    ASSERT(FALSE);			// machine->Run never returns
+}
+
+//----------------------------------------------------------------------
+// Checkpoint::Checkpoint
+// 	Arrange to take a checkpoint at the first chance after "time".
+//
+//	"name" -- the file to write the checkpoint to
+//	"time" -- the simulated time to take it at, or soon after
+//----------------------------------------------------------------------
+
+Checkpoint::Checkpoint(char *name, int time)
+{
+    fileName = name;
+    when = time;
+}
+
+//----------------------------------------------------------------------
+// Checkpoint::TimeSlice
+// 	Called when the timer is about to switch out the user program
+//	that is running, between two of its instructions.  Take the
+//	checkpoint if it is time, and nothing else is in the way.
+//
+//	Returns TRUE if the checkpoint has been taken, or never can be.
+//----------------------------------------------------------------------
+
+bool
+Checkpoint::TimeSlice()
+{
+    if (numCPUs > 1) {
+	printf("Checkpoints can only be taken with a single CPU.\n");
+	return TRUE;
+    }
+    if (stats->totalTicks < when || !Quiescent())
+	return FALSE;
+    Write();
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Checkpoint::Quiescent
+// 	Return TRUE if the only interrupt pending is the timer's, and every
+//	thread but the one running is a user program switched out at a
+//	point it can be restarted from with just its user registers -- or
+//	the pager, waiting for work.
+//----------------------------------------------------------------------
+
+bool
+Checkpoint::Quiescent()
+{
+    int due;
+
+    if (!interrupt->OnlyPending(TimerInt, &due))
+	return FALSE;
+    for (int i = 0; i < MaxThread; i++) {
+	Thread *thread = threadPtr[i];
+
+	if (thread != NULL && thread != currentThread
+		&& thread != threadToBeDestroyed
+		&& (pager == NULL || !pager->Asleep(thread))
+		&& (thread->space == NULL || !thread->restartable))
+	    return FALSE;
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Checkpoint::Write
+// 	Write the checkpoint, in the format described at the top of this
+//	file.
+//----------------------------------------------------------------------
+
+void
+Checkpoint::Write()
+{
+    int fd = OpenForWrite(fileName);
+    int header[NumHeaderWords], due, numThreads = 0;
+
+    header[0] = CheckpointMagic;
+    header[1] = PageSize;
+    header[2] = NumPhysPages;
+    header[3] = (machine->tlb != NULL) ? TLBSize : 0;
+    header[4] = NumTotalRegs;
+    header[5] = (machine->tlb != NULL) ? TLBWays : 0;
+    WriteFile(fd, (char *) header, sizeof(header));
+
+    interrupt->OnlyPending(TimerInt, &due);
+    WriteFile(fd, (char *) stats, sizeof(Statistics));
+    WriteFile(fd, (char *) &due, sizeof(due));
+
+    WriteFile(fd, (char *) &Machine::lruClock, sizeof(Machine::lruClock));
+    WriteFile(fd, (char *) &machine->tlbinfo, sizeof(machine->tlbinfo));
+    if (machine->tlb != NULL)
+	WriteFile(fd, (char *) machine->tlb, TLBSize * sizeof(TranslationEntry));
+    WriteFile(fd, machine->mainMemory, MemorySize);
+
+    for (int i = 0; i < MaxThread; i++)
+	if (threadPtr[i] != NULL && threadPtr[i] != threadToBeDestroyed
+		&& (pager == NULL || !pager->Asleep(threadPtr[i])))
+	    numThreads++;
+    WriteFile(fd, (char *) &numThreads, sizeof(numThreads));
+    currentThread->SaveUserState();
+    currentThread->WriteBack(fd);
+    checkpointFile = fd;
+    numWritten = 1;
+    scheduler->Apply(WriteThread);
+    ASSERT(numWritten == numThreads);
+
+#ifdef FILESYS
+    WriteHostFile(fd, "DISK");
+#else
+    WriteHostFile(fd, swapSpace->Name());
+#endif
+    Close(fd);
+    printf("Checkpoint written to %s at time %d.\n", fileName,
+	   stats->totalTicks);
+}
+
+//----------------------------------------------------------------------
+// RestoreCheckpoint
+// 	Resume the run saved in a checkpoint file, in place of starting a
+//	user program.  The current thread becomes the one that was running
+//	when the checkpoint was taken; the others are re-created in the
+//	order they were on the ready list.  Then, just as the checkpointed
+//	run did, the current thread gives up the CPU.
+//
+//	Only returns if the file isn't a checkpoint of this machine.
+//
+//	"name" -- the checkpoint file
+//----------------------------------------------------------------------
+
+void
+RestoreCheckpoint(char *name)
+{
+    int fd = OpenForReadWrite(name, TRUE);
+    int header[NumHeaderWords], due, numThreads;
+    Thread *thread;
+    AddrSpace *space;
+    Statistics saved;
+
+    Read(fd, (char *) header, sizeof(header));
+    if (header[0] != CheckpointMagic || header[1] != PageSize
+	    || header[2] != NumPhysPages || header[4] != NumTotalRegs
+	    || header[3] != ((machine->tlb != NULL) ? TLBSize : 0)
+	    || header[5] != ((machine->tlb != NULL) ? TLBWays : 0)) {
+	printf("%s is not a checkpoint of this machine.\n", name);
+	Close(fd);
+	return;
+    }
+
+    Read(fd, (char *) &saved, sizeof(Statistics));
+    Read(fd, (char *) &due, sizeof(due));
+    interrupt->Reschedule(TimerInt, due);	// not due till after we're done
+
+    Read(fd, (char *) &Machine::lruClock, sizeof(Machine::lruClock));
+    Read(fd, (char *) &machine->tlbinfo, sizeof(machine->tlbinfo));
+    if (machine->tlb != NULL)
+	Read(fd, (char *) machine->tlb, TLBSize * sizeof(TranslationEntry));
+    Read(fd, machine->mainMemory, MemorySize);
+
+    Read(fd, (char *) &numThreads, sizeof(numThreads));
+    currentThread->FetchFrom(fd);
+    currentThread->space->MarkInUse();
+    for (int i = 1; i < numThreads; i++) {
+	thread = Thread::GenThread("restored");
+	thread->FetchFrom(fd);
+	space = thread->space;
+	space->MarkInUse();
+	thread->space = NULL;		// until it runs
+	thread->Fork(ResumeProcess, (void *) space);
+    }
+
+    ReadHostFile(fd);
+    Close(fd);
+
+    *stats = saved;			// forking the threads took time
+    for (int i = 0; i < numCPUs; i++)
+	cpus[i]->clock = stats->totalTicks;
+    printf("Restored %s at time %d.\n", name, stats->totalTicks);
+    currentThread->space->RestoreState();
+    currentThread->RestoreUserState();
+    currentThread->Yield();		// as the checkpointed thread did
+    machine->Run();			// and carry on with it
+    ASSERT(FALSE);
+}
@@ -0,0 +1,63 @@
+// checkpoint.h
+//	Data structures for saving the state of the simulated machine, and
+//	of the user programs running on it, in a checkpoint file, so that
+//	many runs can start from the same point without repeating the
+//	work of getting there.
+//
+//	With -checkpoint, the checkpoint is taken at the first time slice
+//	of a user program at or after the given time, at which every
+//	other user program is also switched out between user
+//	instructions, and the timer is the only device with an interrupt
+//	pending.  There is then no kernel state to save but the threads'
+//	user registers and page tables, and the run carries on as if
+//	nothing had happened.  -restore starts a new run from the file,
+//	with the same times, statistics, thread ids, memory contents and
+//	swap file, in place of -x.
+//
+//	Not saved: files the user programs have open, the state of the
+//	random number generator (so -rs runs diverge after a restore), and
+//	threads that are not running user programs.  A thread waiting in
+//	Join resumes by making the system call again.  Checkpoints are
+//	only taken with a single CPU, and must be restored by the same
+//	Nachos binary that wrote them.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "copyright.h"
+#include "utility.h"
+
+#define CheckpointMagic	0x4e434b50	// "NCKP"
+
+// The following class defines a checkpoint waiting to be taken.
+
+class Checkpoint {
+  public:
+    Checkpoint(char *name, int time);	// Take a checkpoint into the file
+					// "name", once it is "time"
+    bool TimeSlice();			// A user program is being switched
+					// out; TRUE if the checkpoint has
+					// now been taken (or can't be)
+
+  private:
+    bool Quiescent();			// Is everything else switched out?
+    void Write();			// Write out the checkpoint
+
+    char *fileName;			// where the checkpoint goes
+    int when;				// earliest time to take it
+};
+
+extern void RestoreCheckpoint(char *name);
+					// Resume the run checkpointed in the
+					// file "name"; does not return
+
+// Strings in a checkpoint are written as their length and their bytes.
+
+extern void WriteString(int fd, char *str);
+extern char *ReadString(int fd);
+
+#endif // CHECKPOINT_H
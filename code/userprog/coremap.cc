@@ -0,0 +1,515 @@
+// coremap.cc
+//	Routines to allocate the frames of physical memory, replacing
+//	pages when there are none free.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "coremap.h"
+#include "system.h"
+#include "addrspace.h"
+
+//----------------------------------------------------------------------
+// FreeMappings
+// 	Forget every page mapped to a frame.
+//----------------------------------------------------------------------
+
+static void
+FreeMappings(FrameInfo *info)
+{
+    Mapping *m;
+
+    while ((m = info->mappings) != NULL) {
+	info->mappings = m->next;
+	delete m;
+    }
+}
+
+//----------------------------------------------------------------------
+// CoreMap::CoreMap
+// 	Initialize the core map, with every frame free.
+//
+//	"n" -- the number of frames of physical memory
+//----------------------------------------------------------------------
+
+CoreMap::CoreMap(int n)
+{
+    numFrames = n;
+    numFree = n;
+    frames = new FrameInfo[numFrames];
+    for (int i = 0; i < numFrames; i++) {
+	frames[i].state = FreeFrame;
+	frames[i].mappings = NULL;
+    }
+    policy = NewReplacementPolicy(this);
+    changed = new Semaphore("core map", 0);
+    numWaiting = 0;
+}
+
+CoreMap::~CoreMap()
+{
+    delete policy;
+    delete changed;
+    for (int i = 0; i < numFrames; i++)
+	FreeMappings(&frames[i]);
+    delete [] frames;
+}
+
+//----------------------------------------------------------------------
+// CoreMap::Allocate
+// 	Find a frame for page "vpn" of "space": a free one if there is
+//	one, or else the frame of the page the replacement policy chooses,
+//	which is written out (if it is dirty) and unmapped from every
+//	address space that shares it.  If every page that could be
+//	replaced belongs to a program running on another CPU, wait for
+//	one of them to enter the kernel, or for a frame to be freed.
+//
+//	The frame is returned busy; the caller fills it in, maps it, and
+//	then calls Mapped.
+//
+//	With a pager, a frame is normally free: the pager is woken when
+//	they run low.  A page is only replaced here if it has fallen
+//	behind.
+//----------------------------------------------------------------------
+
+int
+CoreMap::Allocate(AddrSpace *space, int vpn)
+{
+    int frame;
+    Mapping *m;
+
+    for (;;) {
+	if ((frame = TakeFree(space, vpn)) != -1)
+	    return frame;
+	if (pager != NULL)
+	    pager->FramesFree(0);
+	if ((frame = FindVictim()) != -1) {
+	    DEBUG('a', "Replacing page %d in frame %d\n", Page(frame), frame);
+	    frames[frame].state = BusyFrame;
+	    stats->numPageReplacements++;
+	    Evict(frame);
+	    policy->Evicted(frame);
+	    FreeMappings(&frames[frame]);
+	    Changed();			// the old page is out
+	    break;
+	}
+	Wait();
+    }
+    m = new Mapping;
+    m->space = space;
+    m->vpn = vpn;
+    m->next = NULL;
+    frames[frame].mappings = m;
+    return frame;
+}
+
+//----------------------------------------------------------------------
+// CoreMap::AllocateFree
+// 	Like Allocate, but for a page that is only being prefetched: no
+//	page is replaced for it.  Returns -1 if no frame is free.
+//----------------------------------------------------------------------
+
+int
+CoreMap::AllocateFree(AddrSpace *space, int vpn)
+{
+    return TakeFree(space, vpn);
+}
+
+//----------------------------------------------------------------------
+// CoreMap::TakeFree
+// 	Return a free frame, made busy for page "vpn" of "space", or -1
+//	if there is none.  Wake the pager if that leaves too few free.
+//----------------------------------------------------------------------
+
+int
+CoreMap::TakeFree(AddrSpace *space, int vpn)
+{
+    for (int frame = 0; frame < numFrames; frame++)
+	if (frames[frame].state == FreeFrame) {
+	    frames[frame].state = BusyFrame;
+	    frames[frame].mappings = new Mapping;
+	    frames[frame].mappings->space = space;
+	    frames[frame].mappings->vpn = vpn;
+	    frames[frame].mappings->next = NULL;
+	    numFree--;
+	    if (pager != NULL)
+		pager->FramesFree(numFree);
+	    return frame;
+	}
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// CoreMap::Reclaim
+// 	Replace the page the replacement policy chooses, as Allocate
+//	would, but leave its frame free.  Returns the frame, or -1 if no
+//	page can be replaced now.
+//----------------------------------------------------------------------
+
+int
+CoreMap::Reclaim()
+{
+    int frame;
+
+    for (frame = 0; frame < numFrames; frame++)
+	if (frames[frame].state == MappedFrame)
+	    break;
+    if (frame == numFrames || (frame = FindVictim()) == -1)
+	return -1;
+    DEBUG('a', "Reclaiming page %d from frame %d\n", Page(frame), frame);
+    frames[frame].state = BusyFrame;
+    stats->numPagesReclaimed++;
+    Evict(frame);
+    policy->Evicted(frame);
+    FreeMappings(&frames[frame]);
+    frames[frame].state = FreeFrame;
+    numFree++;
+    Changed();
+    return frame;
+}
+
+void
+CoreMap::Mapped(int frame)
+{
+    ASSERT(frames[frame].state == BusyFrame);
+    frames[frame].state = MappedFrame;
+    policy->Loaded(frame);
+    Changed();
+}
+
+//----------------------------------------------------------------------
+// CoreMap::Busy, CoreMap::Written
+// 	The page in a frame is being written out, but stays mapped, as a
+//	forked address space takes a copy of it (see AddrSpace::AddrSpace).
+//	Keep the frame busy meanwhile, so that the page is not replaced,
+//	and its address space waits in CopyOnWrite before changing it.
+//----------------------------------------------------------------------
+
+void
+CoreMap::Busy(int frame)
+{
+    ASSERT(frames[frame].state == MappedFrame);
+    frames[frame].state = BusyFrame;
+}
+
+void
+CoreMap::Written(int frame)
+{
+    ASSERT(frames[frame].state == BusyFrame);
+    frames[frame].state = MappedFrame;
+    Changed();
+}
+
+//----------------------------------------------------------------------
+// CoreMap::Share
+// 	Add page "vpn" of "space" to those mapped to a frame that is
+//	already mapped, as a forked address space shares its parent's
+//	pages.
+//----------------------------------------------------------------------
+
+void
+CoreMap::Share(int frame, AddrSpace *space, int vpn)
+{
+    Mapping *m = new Mapping;
+
+    ASSERT(frames[frame].state == MappedFrame);
+    m->space = space;
+    m->vpn = vpn;
+    m->next = frames[frame].mappings;
+    frames[frame].mappings = m;
+}
+
+//----------------------------------------------------------------------
+// CoreMap::Free
+// 	Take page "vpn" of "space" off the pages mapped to a frame.  When
+//	it was the last, the frame is free again, and TRUE is returned.
+//----------------------------------------------------------------------
+
+bool
+CoreMap::Free(int frame, AddrSpace *space, int vpn)
+{
+    Mapping **p, *m;
+
+    for (p = &frames[frame].mappings; (m = *p) != NULL; p = &m->next)
+	if (m->space == space && m->vpn == vpn)
+	    break;
+    ASSERT(m != NULL);
+    *p = m->next;
+    delete m;
+    if (frames[frame].mappings != NULL)
+	return FALSE;
+    policy->Freed(frame);
+    frames[frame].state = FreeFrame;
+    numFree++;
+    Changed();
+    return TRUE;
+}
+
+int
+CoreMap::Sharers(int frame)
+{
+    int n = 0;
+
+    for (Mapping *m = frames[frame].mappings; m != NULL; m = m->next)
+	n++;
+    return n;
+}
+
+//----------------------------------------------------------------------
+// CoreMap::FindText
+// 	Return the frame where another address space running the same
+//	executable as "space" has page "vpn", a page of code, mapped; or
+//	-1 if none has.
+//----------------------------------------------------------------------
+
+int
+CoreMap::FindText(AddrSpace *space, int vpn)
+{
+    for (int frame = 0; frame < numFrames; frame++) {
+	Mapping *m = frames[frame].mappings;
+
+	if (frames[frame].state == MappedFrame && m->vpn == vpn
+		&& space->SharesText(m->space, vpn))
+	    return frame;
+    }
+    return -1;
+}
+
+void
+CoreMap::Claim(int frame, AddrSpace *space, int vpn)
+{
+    if (frames[frame].state == MappedFrame) {
+	Share(frame, space, vpn);
+	return;
+    }
+    frames[frame].state = MappedFrame;
+    numFree--;
+    frames[frame].mappings = new Mapping;
+    frames[frame].mappings->space = space;
+    frames[frame].mappings->vpn = vpn;
+    frames[frame].mappings->next = NULL;
+    policy->Loaded(frame);
+}
+
+void
+CoreMap::Forget(AddrSpace *space)
+{
+    policy->Forget(space);
+}
+
+//----------------------------------------------------------------------
+// CoreMap::InTransit
+// 	Return TRUE if page "vpn" of "space" -- or any of its pages, if
+//	"vpn" is -1 -- is in a busy frame: it is being read in, or it has
+//	been unmapped and is being written out.  Either way, it must not
+//	be read in again until that is done: WaitForTransit waits for it.
+//----------------------------------------------------------------------
+
+bool
+CoreMap::InTransit(AddrSpace *space, int vpn)
+{
+    for (int frame = 0; frame < numFrames; frame++)
+	if (frames[frame].state == BusyFrame)
+	    for (Mapping *m = frames[frame].mappings; m != NULL; m = m->next)
+		if (m->space == space && (vpn == -1 || m->vpn == vpn))
+		    return TRUE;
+    return FALSE;
+}
+
+void
+CoreMap::WaitForTransit(AddrSpace *space, int vpn)
+{
+    while (InTransit(space, vpn))
+	Wait();
+}
+
+//----------------------------------------------------------------------
+// CoreMap::Wait
+// 	Sleep until some frame changes state: a page has been read into
+//	a busy frame, or written out of it, or a frame has been freed --
+//	or, with HOST_THREADS, until a program running on another CPU
+//	has entered the kernel, so that its pages may be replaced.
+//
+//	The caller has just found that it must wait.  No other thread can
+//	run between that and the wait, as the time doesn't advance (and,
+//	with HOST_THREADS, the kernel lock is held), so no call to Changed
+//	is missed.
+//----------------------------------------------------------------------
+
+void
+CoreMap::Wait()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    numWaiting++;
+    changed->P();
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// CoreMap::Changed
+// 	Wake every thread in Wait, to look again.  A thread that comes to
+//	wait while they are being woken is woken as well.
+//----------------------------------------------------------------------
+
+void
+CoreMap::Changed()
+{
+    IntStatus oldLevel;
+
+    if (numWaiting == 0)
+	return;
+    oldLevel = interrupt->SetLevel(IntOff);
+    while (numWaiting > 0) {
+	numWaiting--;
+	changed->V();
+    }
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// CoreMap::Replaceable
+// 	Return TRUE if the frame holds a mapped page that may be replaced
+//	now.  With HOST_THREADS, the pages of programs running on other
+//	CPUs are left alone, as those CPUs could be using them right now.
+//----------------------------------------------------------------------
+
+bool
+CoreMap::Replaceable(int frame)
+{
+    if (frames[frame].state != MappedFrame)
+	return FALSE;
+    for (Mapping *m = frames[frame].mappings; m != NULL; m = m->next)
+	if (m->space->RunningElsewhere())
+	    return FALSE;
+    return TRUE;
+}
+
+TranslationEntry *
+CoreMap::Entry(int frame)
+{
+    return Owner(frame)->Lookup(Page(frame));
+}
+
+//----------------------------------------------------------------------
+// CoreMap::Clean
+// 	Write the dirty page in a frame to its swap slot, but leave it in
+//	memory, so that it can later be replaced without waiting for the
+//	write.  The page is dropped from the TLBs first, so that none of
+//	them still has it marked dirty; the caller has brought the dirty
+//	bits up to date from them.
+//----------------------------------------------------------------------
+
+void
+CoreMap::Clean(int frame)
+{
+    Mapping *m, *first = frames[frame].mappings;
+    int slot;
+
+    DEBUG('a', "Cleaning page %d in frame %d\n", first->vpn, frame);
+    for (m = first; m != NULL; m = m->next) {
+	m->space->EvictPage(m->vpn);
+	m->space->Lookup(m->vpn)->dirty = FALSE;
+    }
+    slot = first->space->SwapOut(first->vpn, frame);
+    for (m = first->next; m != NULL; m = m->next)
+	m->space->ShareSlot(m->vpn, slot);
+}
+
+//----------------------------------------------------------------------
+// CoreMap::Evict
+// 	Take the page in a frame out of memory, so that the frame can be
+//	given to another page: drop it from the TLBs, unmap it from all
+//	the address spaces sharing it, and then, if any of them has
+//	changed it, write it to its swap slot.  A clean page is just
+//	dropped; it is still in its swap slot, or in the executable.
+//
+//	The write may wait for the disk, and let other threads run.  As
+//	the page is no longer mapped, none of them can change it under
+//	the write; one that faults on it waits in PageIn until the frame
+//	is no longer busy, and then reads it back from the slot.
+//----------------------------------------------------------------------
+
+void
+CoreMap::Evict(int frame)
+{
+    Mapping *m, *first = frames[frame].mappings;
+    bool dirty = FALSE;
+    int slot;
+
+    DEBUG('a', "Paging out page %d from frame %d\n", first->vpn, frame);
+    for (m = first; m != NULL; m = m->next) {
+	m->space->EvictPage(m->vpn);
+	if (m->space->Lookup(m->vpn)->dirty)
+	    dirty = TRUE;
+    }
+    if (dirty) {
+	slot = first->space->SwapSlot(first->vpn);
+	for (m = first->next; m != NULL; m = m->next)
+	    m->space->ShareSlot(m->vpn, slot);
+    }
+    for (m = first; m != NULL; m = m->next)
+	m->space->Unmap(m->vpn);
+    if (dirty) {
+	stats->numPageOuts++;
+	swapSpace->WritePage(slot, &machine->mainMemory[frame * PageSize]);
+    }
+}
+
+//----------------------------------------------------------------------
+// CoreMap::FindVictim
+// 	Bring every page table up to date with the TLBs, and ask the
+//	replacement policy for the frame to replace.  Returns -1 if every
+//	mapped page belongs to a program running on another CPU.
+//----------------------------------------------------------------------
+
+int
+CoreMap::FindVictim()
+{
+    int victim;
+
+    AddrSpace::SyncAllTLBs();
+    MergeSharers();
+    victim = policy->FindVictim();
+    if (victim != -1)
+	return victim;
+    for (int i = 0; i < numFrames; i++)
+	if (frames[i].state == MappedFrame)
+	    return -1;
+    printf("Every frame of physical memory is busy.\n");
+    ASSERT(FALSE);
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// CoreMap::MergeSharers
+// 	For each frame shared by several address spaces, fold the use and
+//	dirty bits and the latest reference time of every page mapped to
+//	it into the first, which is the one the replacement policy looks
+//	at.  The others' use bits are cleared, so that a policy clearing
+//	the first's sees whether the page is used again.
+//----------------------------------------------------------------------
+
+void
+CoreMap::MergeSharers()
+{
+    TranslationEntry *first, *entry;
+
+    for (int i = 0; i < numFrames; i++) {
+	if (frames[i].state != MappedFrame || frames[i].mappings->next == NULL)
+	    continue;
+	first = Entry(i);
+	for (Mapping *m = frames[i].mappings->next; m != NULL; m = m->next) {
+	    entry = m->space->Lookup(m->vpn);
+	    if (entry->use)
+		first->use = TRUE;
+	    if (entry->dirty)
+		first->dirty = TRUE;
+	    if (entry->lrutime > first->lrutime)
+		first->lrutime = entry->lrutime;
+	    entry->use = FALSE;
+	}
+    }
+}
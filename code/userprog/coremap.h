@@ -0,0 +1,130 @@
+// coremap.h
+//	Data structures for the core map: what every frame of physical
+//	memory holds, across all the address spaces.
+//
+//	Each frame is free, holds a page that is mapped in its address
+//	space's page table, or is busy -- a page is being read into it or
+//	written out of it, and it must not be chosen for replacement.
+//	When no frame is free, the page replaced is chosen from all the
+//	pages in memory, whichever address space they belong to, by the
+//	replacement policy chosen with -replace.
+//
+//	After a Fork, the page in a frame can be mapped, copy-on-write, in
+//	several address spaces; the frame keeps a list of them, and is
+//	only free when none is left.  Replacing the page takes it out of
+//	all of them.  The replacement policy only looks at the first
+//	mapping: the others' use bits and reference times are merged into
+//	it before a page is chosen.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef COREMAP_H
+#define COREMAP_H
+
+#include "copyright.h"
+#include "utility.h"
+#include "synch.h"
+#include "translate.h"
+#include "replacement.h"
+
+class AddrSpace;
+
+enum FrameState { FreeFrame, MappedFrame, BusyFrame };
+
+// A page mapped to a frame.
+
+typedef struct Mapping {
+    AddrSpace *space;
+    int vpn;
+    struct Mapping *next;		// the next page mapped to the frame
+} Mapping;
+
+// What the core map knows about one frame.
+
+typedef struct {
+    FrameState state;
+    Mapping *mappings;			// the pages in it, unless free
+} FrameInfo;
+
+// The following class defines the core map.
+
+class CoreMap {
+  public:
+    CoreMap(int numFrames);		// All frames are free
+    ~CoreMap();
+
+    int Allocate(AddrSpace *space, int vpn);
+					// Return a busy frame for page "vpn"
+					// of "space", replacing a page if
+					// need be
+    int AllocateFree(AddrSpace *space, int vpn);
+					// The same, but only if a frame is
+					// free; else return -1
+    int Reclaim();			// Free a frame by replacing the page
+					// in it, for the pager; return -1
+					// if no page can be replaced now
+    int NumFree() { return numFree; }
+    void Mapped(int frame);		// The page is in the frame, and
+					// mapped
+    void Busy(int frame);		// The mapped page in the frame is
+					// being written out, and must not
+					// change meanwhile
+    void Written(int frame);		// It is out
+    void Share(int frame, AddrSpace *space, int vpn);
+					// Page "vpn" of "space" is mapped to
+					// the frame as well
+    bool Free(int frame, AddrSpace *space, int vpn);
+					// Page "vpn" of "space" is no longer
+					// mapped to the frame; return TRUE
+					// if that leaves the frame free
+    int Sharers(int frame);		// How many pages are mapped to it
+    int FindText(AddrSpace *space, int vpn);
+					// The frame holding code page "vpn"
+					// of the executable "space" runs,
+					// or -1
+    void Claim(int frame, AddrSpace *space, int vpn);
+					// Page "vpn" of "space" is mapped
+					// to the frame, in a checkpoint
+					// being restored
+    void Forget(AddrSpace *space);	// "space" is going away
+    bool InTransit(AddrSpace *space, int vpn);
+					// Is page "vpn" of "space" (any of
+					// its pages, if -1) in a busy frame?
+    void WaitForTransit(AddrSpace *space, int vpn);
+					// Wait until it is not
+    void Changed();			// Wake the threads waiting for a
+					// frame to change state
+
+    // For the replacement policy.
+    int NumFrames() { return numFrames; }
+    bool Replaceable(int frame);	// Does the frame hold a page that
+					// could be replaced now?
+    AddrSpace *Owner(int frame) { return frames[frame].mappings->space; }
+    int Page(int frame) { return frames[frame].mappings->vpn; }
+    TranslationEntry *Entry(int frame);	// The page's page table entry
+    void Clean(int frame);		// Write the page out, leaving it in
+					// memory
+
+  private:
+    int TakeFree(AddrSpace *space, int vpn);
+					// A free frame, made busy, or -1
+    int FindVictim();			// The frame to replace
+    void Evict(int frame);		// Write the page in it out if need
+					// be, and unmap it everywhere
+    void MergeSharers();		// Bring the first mapping of each
+					// shared frame up to date with the
+					// others
+    void Wait();			// Sleep until Changed is called
+
+    FrameInfo *frames;			// one per physical page
+    int numFrames;
+    int numFree;			// how many frames are free
+    ReplacementPolicy *policy;		// chooses the page to replace
+    Semaphore *changed;			// threads wait here for a frame to
+					// change state
+    int numWaiting;			// how many are waiting
+};
+
+#endif // COREMAP_H
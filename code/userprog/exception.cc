@@ -31,84 +31,143 @@ extern void StartProcess(char *file);
 //#define TLB_FIFO
 #define TLB_LRU
 
-int TLBVictim(){
-	for(int i = 0; i < TLBSize; ++i)
+// the entry to replace, in the set of the TLB that page "vpn" goes in
+int TLBVictim(int vpn){
+	int first = machine->TLBSet(vpn), last = first + TLBWays - 1;
+
+	for(int i = first; i <= last; ++i)
 		if(!machine->tlb[i].valid)
 			return i;
 
 #ifdef TLB_FIFO
-	for(int i = TLBSize - 1; i > 0; --i)
+	AddrSpace::WriteBackEntry(&machine->tlb[last]);
+	for(int i = last; i > first; --i)
     	machine->tlb[i] = machine->tlb[i - 1];  
-	return 0;
+	machine->tlb[first].valid = FALSE;	// already written back
+	return first;
 #endif
 
 #ifdef TLB_LRU
-	int pos = 0, max = 0;
-	for(int i = 0; i < TLBSize; ++i){
-		if(machine->tlb[i].lrutime > max){
-			max = machine->tlb[i].lrutime;
+	int pos = first;	// least recently used = oldest lrutime stamp
+	for(int i = first + 1; i <= last; ++i)
+		if(machine->tlb[i].lrutime < machine->tlb[pos].lrutime)
 			pos = i;
-		}
-	}
 	return pos;
 #endif
 }
-void PageTableFetch(int vpn){
-	OpenFile *openfile = fileSystem->Open(currentThread->getFileName());
-    ASSERT(openfile != NULL);
-    int fileAddr, tsize, pos = machine->bitmap->Find();
-    if(pos == -1){
-    	int max = 0;
-    	pos = 0;
-		for(int i = 0; i < machine->pageTableSize; ++i){
-			if(machine->pageTable[i].valid && machine->pageTable[i].lrutime > max){
-				max = machine->pageTable[i].lrutime;
-				pos = i;
-			}
+
+//----------------------------------------------------------------------
+// UserPage
+// 	Return where user virtual address "virtAddr" is in main memory,
+//	faulting its page in first if need be, and doing the bookkeeping
+//	Translate would do for a reference to the page.  The rest of the
+//	page follows it.
+//
+//	A page shared copy-on-write is copied first if "writing" to it.
+//	Returns NULL if "virtAddr" is outside the address space, or if
+//	"writing" to a read-only page.
+//----------------------------------------------------------------------
+
+static char *
+UserPage(int virtAddr, bool writing)
+{
+	unsigned int vpn = (unsigned) virtAddr / PageSize;
+	TranslationEntry *entry;
+
+	if(!currentThread->space->Holds(vpn))
+		return NULL;
+	entry = machine->pageTable->Lookup(vpn);
+	if(entry == NULL || !entry->valid){
+		currentThread->space->PageIn(vpn);
+		entry = machine->pageTable->Lookup(vpn);
+	}
+	if(writing && entry->readOnly){
+		if(!currentThread->space->CopyOnWrite(vpn))
+			return NULL;
+		entry = machine->pageTable->Lookup(vpn);
+		if(entry == NULL || !entry->valid){	// replaced meanwhile
+			currentThread->space->PageIn(vpn);
+			entry = machine->pageTable->Lookup(vpn);
 		}
-		machine->pageTable[pos].valid = FALSE;
-		for(int i = 0; i < TLBSize; ++i)
-			if(machine->tlb[i].physicalPage == machine->pageTable[pos].physicalPage){
-				if(machine->tlb[i].dirty)
-					machine->pageTable[pos].dirty = TRUE;
-				machine->tlb[i].valid = FALSE;
-				break;
-			}
-		if(machine->pageTable[pos].dirty){
-    		fileAddr = machine->pageTable[pos].virtualPage * PageSize;
-    		tsize = fileAddr + PageSize < currentThread->fileInfo.size ?
-    			PageSize:currentThread->fileInfo.size - fileAddr;
-    		openfile->WriteAt(
-    			&(machine->mainMemory[machine->pageTable[pos].physicalPage * PageSize]),
-    			tsize, fileAddr);
-    	}
-    	pos = machine->pageTable[pos].physicalPage;
-    }
-    fileAddr = vpn * PageSize;
-    tsize = fileAddr + PageSize < currentThread->fileInfo.size ?
-    	PageSize:currentThread->fileInfo.size - fileAddr;
-  	//printf("Page fault at vpn %d, phys page %d allocated.\n", vpn, pos);
-    openfile->ReadAt(&(machine->mainMemory[pos * PageSize]), tsize, fileAddr);
-    machine->pageTable[vpn].virtualPage = vpn;
-    machine->pageTable[vpn].physicalPage = pos;
-    machine->pageTable[vpn].lrutime = 0;
-    machine->pageTable[vpn].valid = TRUE;
-    machine->pageTable[vpn].readOnly = FALSE;
-    machine->pageTable[vpn].use = FALSE;
-    machine->pageTable[vpn].dirty = FALSE;
-    delete openfile;
+		if(entry->readOnly)
+			return NULL;
+	}
+	entry->lrutime = Machine::NextLRUTime();
+	entry->use = TRUE;
+	if(writing){
+		entry->dirty = TRUE;
+		machine->InvalidateDecodeCache(entry->physicalPage);
+	}
+	return &machine->mainMemory[entry->physicalPage * PageSize
+			+ (unsigned) virtAddr % PageSize];
+}
+
+//----------------------------------------------------------------------
+// CopyIn, CopyOut
+// 	Copy "size" bytes between user virtual address "virtAddr" and the
+//	kernel buffer "buf", a page at a time.
+//
+//	Returns FALSE if part of the user buffer is outside the address
+//	space (or read-only, for CopyOut); some of it may have been copied.
+//----------------------------------------------------------------------
+
+bool
+CopyIn(int virtAddr, char *buf, int size)
+{
+	while(size > 0){
+		int n = min(size, PageSize - (int) ((unsigned) virtAddr % PageSize));
+		char *from = UserPage(virtAddr, FALSE);
+		if(from == NULL)
+			return FALSE;
+		bcopy(from, buf, n);
+		virtAddr += n;
+		buf += n;
+		size -= n;
+	}
+	return TRUE;
 }
 
-void getStr(int addr, char *str, int &len)
+bool
+CopyOut(char *buf, int virtAddr, int size)
 {
-	int tmp = 0;
-	len = 0;
-	while(TRUE){
-		while(!machine->ReadMem(addr + len, 1, &tmp));
-		if((str[len++] = char(tmp)) == 0)
-			break;
+	while(size > 0){
+		int n = min(size, PageSize - (int) ((unsigned) virtAddr % PageSize));
+		char *to = UserPage(virtAddr, TRUE);
+		if(to == NULL)
+			return FALSE;
+		bcopy(buf, to, n);
+		virtAddr += n;
+		buf += n;
+		size -= n;
 	}
-	len--;
+	return TRUE;
+}
+
+//----------------------------------------------------------------------
+// CopyInString
+// 	Copy the null-terminated string at user virtual address "virtAddr"
+//	into "buf", which holds "size" bytes.
+//
+//	Returns the length of the string, or -1 if it runs outside the
+//	address space, or doesn't fit.
+//----------------------------------------------------------------------
+
+int
+CopyInString(int virtAddr, char *buf, int size)
+{
+	int len = 0;
+
+	while(len < size){
+		int n = min(size - len,
+			PageSize - (int) ((unsigned) (virtAddr + len) % PageSize));
+		char *from = UserPage(virtAddr + len, FALSE);
+		if(from == NULL)
+			return -1;
+		for(int i = 0; i < n; i++, len++)
+			if((buf[len] = from[i]) == '\0')
+				return len;
+	}
+	return -1;
 }
 typedef struct
 {
@@ -162,6 +221,10 @@ ExceptionHandler(ExceptionType which)
 {
     int type = machine->ReadRegister(2);
 
+#ifdef HOST_THREADS
+    coreMap->Changed();		// now that we are in the kernel, our pages
+				// may be replaced (see CoreMap::Allocate)
+#endif
     if ((which == SyscallException) && (type == SC_Halt)) {
 		DEBUG('a', "Shutdown, initiated by user program.\n");
    		interrupt->Halt();
@@ -173,7 +236,9 @@ ExceptionHandler(ExceptionType which)
 	    printf("tlb access: %d, tlb miss: %d, miss rate: %f%%\n", 
 	    	machine->tlbinfo.time, machine->tlbinfo.miss, machine->tlbinfo.miss/(double)machine->tlbinfo.time*100);
 
-		machine->DeallocatePage();
+		if (trace != NULL)
+			trace->Exit();
+		currentThread->space->Release();
 		//fileSystem->Remove(currentThread->getFileName());
 	    machine->AdvancePC(machine->ReadRegister(NextPCReg) + 4);	    
 	    currentThread->Finish();
@@ -182,21 +247,21 @@ ExceptionHandler(ExceptionType which)
 		DEBUG('a', "Create a file.\n");
 
 		char fileName[256];
-		int len;
-		getStr(machine->ReadRegister(4), fileName, len);
-		printf("Create file %s\n", fileName);
-		fileSystem->Create(fileName, 0);
+		if(CopyInString(machine->ReadRegister(4), fileName, 256) != -1){
+			printf("Create file %s\n", fileName);
+			fileSystem->Create(fileName, 0);
+		}
 		machine->AdvancePC(machine->ReadRegister(NextPCReg) + 4);
 	}
 	else if((which == SyscallException) && (type == SC_Open)) {
 		DEBUG('a', "Open a file.\n");
 		
 		char fileName[256];
-		int len;
-		getStr(machine->ReadRegister(4), fileName, len);
-		printf("Open file %s\n", fileName);
-
-		OpenFile *openfile = fileSystem->Open(fileName);
+		OpenFile *openfile = NULL;
+		if(CopyInString(machine->ReadRegister(4), fileName, 256) != -1){
+			printf("Open file %s\n", fileName);
+			openfile = fileSystem->Open(fileName);
+		}
 		machine->WriteRegister(2, (int)openfile);
 		machine->AdvancePC(machine->ReadRegister(NextPCReg) + 4);
 	}
@@ -215,11 +280,18 @@ ExceptionHandler(ExceptionType which)
 			size = machine->ReadRegister(5),
 			fileid = machine->ReadRegister(6);
 		int len;
-		char content[size + 1];
-		if (fileid == ConsoleInput){
+		char *content = new char[size + 1];	// may be too big for the stack
+		if (fileid == ConsoleInput && inputLog != NULL
+				&& inputLog->Replaying()){
+			inputLog->Expect(ReadInput, content, size);
+			len = size;
+		}
+		else if (fileid == ConsoleInput){
 			for (int i = 0; i < size; i++)
 				scanf("%c", &content[i]);
 			len = size;
+			if (inputLog != NULL)
+				inputLog->Record(ReadInput, content, size);
 		}
 		else{
 			OpenFile *openfile = (OpenFile *)fileid;
@@ -228,8 +300,9 @@ ExceptionHandler(ExceptionType which)
 			content[len] = 0;
 		// printf("reading...\n");
 		// printf("str: %s\nlen: %d\n", content, size);
-		for (int i = 0; i < len; i++)
-			while(!(machine->WriteMem(addr + i, 1, (int)content[i])));
+		if (!CopyOut(content, addr, len))
+			len = -1;
+		delete [] content;
 		machine->WriteRegister(2, len);
 		machine->AdvancePC(machine->ReadRegister(NextPCReg) + 4);
 	}
@@ -239,12 +312,9 @@ ExceptionHandler(ExceptionType which)
 		int addr = machine->ReadRegister(4),
 			size = machine->ReadRegister(5),
 			fileid = machine->ReadRegister(6);
-		int tmp;
-		char content[size];
-		for (int i = 0; i < size; i++){
-			while(!(machine->ReadMem(addr + i, 1, &tmp)));
-			content[i] = char(tmp);
-		}
+		char *content = new char[size + 1];	// may be too big for the stack
+		if (!CopyIn(addr, content, size))
+			size = 0;
 		content[size] = 0;
 		if (fileid == ConsoleOutput)
 			printf("%s", content);
@@ -254,19 +324,21 @@ ExceptionHandler(ExceptionType which)
 			OpenFile *openfile = (OpenFile *)fileid;
 			openfile->Write(content, size);
 		}
+		delete [] content;
 		machine->AdvancePC(machine->ReadRegister(NextPCReg) + 4);		
 	}
 	else if((which == SyscallException) && (type == SC_Exec)) {
 		DEBUG('a', "Exec a prog.\n");
 		char fileName[256];
-		int len;
-		getStr(machine->ReadRegister(4), fileName, len);
-
-		printf("Exec: %s\n", fileName);
-		Thread *userThread = Thread::GenThread(fileName);
-		userThread->Fork(StartProcess, fileName);
+		if(CopyInString(machine->ReadRegister(4), fileName, 256) == -1)
+			machine->WriteRegister(2, -1);
+		else{
+			printf("Exec: %s\n", fileName);
+			Thread *userThread = Thread::GenThread(fileName);
+			userThread->Fork(StartProcess, fileName);
 
-		machine->WriteRegister(2, userThread->getTid());
+			machine->WriteRegister(2, userThread->getTid());
+		}
 		machine->AdvancePC(machine->ReadRegister(NextPCReg) + 4);
 	}
 	else if((which == SyscallException) && (type == SC_Fork)) {
@@ -286,42 +358,57 @@ ExceptionHandler(ExceptionType which)
 		DEBUG('a', "Yield current thread.\n");
 		//printf("%s thread yielding...\n", currentThread->getName());
 		machine->AdvancePC(machine->ReadRegister(NextPCReg) + 4);
+		currentThread->restartable = TRUE;	// back to user code next
 		currentThread->Yield();
+		currentThread->restartable = FALSE;
 	}
 	else if((which == SyscallException) && (type == SC_Join)) {
 		DEBUG('a', "Join a thread.\n");
 		int tid = machine->ReadRegister(4);
-		while(threadPtr[tid] != NULL)
+		while(threadPtr[tid] != NULL) {
+			currentThread->restartable = TRUE;	// may re-do the call
 			currentThread->Yield();
+			currentThread->restartable = FALSE;
+		}
 		machine->AdvancePC(machine->ReadRegister(NextPCReg) + 4);
 	}
     else if (which == PageFaultException) {
-    	if (machine->tlb == NULL) {
-    		int vpn = (unsigned) machine->registers[BadVAddrReg] / PageSize;
-    		PageTableFetch(vpn);
-    	}
+	// the pages between the program and its stack aren't there
+	int vpn = (unsigned) machine->registers[BadVAddrReg] / PageSize;
+	if (!currentThread->space->Holds(vpn)) {
+		printf("Reference to 0x%x, outside the address space\n",
+		       machine->registers[BadVAddrReg]);
+		ASSERT(FALSE);
+	}
+    	if (machine->tlb == NULL)
+    		currentThread->space->PageIn(vpn);
     	else {
-    		for(int i = 0; i < machine->pageTableSize; ++i)
-            	machine->pageTable[i].lrutime++;
-		    unsigned int vpn = (unsigned) machine->registers[BadVAddrReg] / PageSize;
-		    if(!machine->pageTable[vpn].valid)
-    			PageTableFetch(vpn);
-	    	int pos = TLBVictim();
-	    	if(machine->tlb[pos].valid && machine->tlb[pos].dirty){
-	    		for(int i = 0; i < machine->pageTableSize; ++i)
-	    			if(machine->pageTable[i].valid && machine->pageTable[i].physicalPage == machine->tlb[pos].physicalPage){
-	    				//printf("physic: %d\n", machine->pageTable[i].physicalPage);
-	    				//printf("pt: %d, tlb: %d\n", machine->pageTable[i].virtualPage, machine->tlb[pos].virtualPage);
-	    				ASSERT(machine->pageTable[i].virtualPage == machine->tlb[pos].virtualPage);
-	    				machine->pageTable[i] = machine->tlb[pos];
-	    			}
-	    	}
-	    	machine->tlb[pos] = machine->pageTable[vpn];
+		    TranslationEntry *entry = machine->pageTable->Lookup(vpn);
+		    if(entry == NULL || !entry->valid){
+    			currentThread->space->PageIn(vpn);
+    			entry = machine->pageTable->Lookup(vpn);
+    		}
+	    	int pos = TLBVictim(vpn);
+	    	// the entry may be another address space's, now that the
+	    	// TLB isn't flushed on a context switch
+	    	AddrSpace::WriteBackEntry(&machine->tlb[pos]);
+	    	machine->tlb[pos] = *entry;
+	    	machine->tlb[pos].asid = machine->asid;
 	    	machine->tlb[pos].valid = TRUE;
 	    	machine->tlb[pos].use = FALSE;
 	    	machine->tlb[pos].dirty = FALSE;
-	    	machine->tlb[pos].readOnly = FALSE;
-	    	machine->tlb[pos].lrutime = 0;
+	    	machine->tlb[pos].lrutime = Machine::lruClock;
+		}
+	}
+	else if (which == ReadOnlyException) {
+		// a page shared with a forked address space; the write is
+		// retried once it has a copy of its own.  Code can't be
+		// written at all.
+		int vpn = (unsigned) machine->registers[BadVAddrReg] / PageSize;
+		if (!currentThread->space->CopyOnWrite(vpn)) {
+			printf("Write to code at 0x%x\n",
+			       machine->registers[BadVAddrReg]);
+			ASSERT(FALSE);
 		}
 	}
 	else {
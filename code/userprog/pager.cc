@@ -0,0 +1,96 @@
+// pager.cc
+//	Routines for the pager thread, which frees frames of physical
+//	memory ahead of the page faults that need them.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "pager.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// PagerThread
+// 	The procedure the pager thread runs.
+//
+//	"arg" -- the Pager
+//----------------------------------------------------------------------
+
+static void
+PagerThread(int arg)
+{
+    ((Pager *) arg)->Run();
+}
+
+//----------------------------------------------------------------------
+// Pager::Pager
+// 	Fork the pager thread, which sleeps until there is work to do.
+//
+//	"low", "high" -- when fewer than "low" frames are free, free
+//	frames until "high" are
+//----------------------------------------------------------------------
+
+Pager::Pager(int low, int high)
+{
+    ASSERT(0 < low && low <= high && high <= NumPhysPages);
+    lowWater = low;
+    highWater = high;
+    wakeup = new Semaphore("pager", 0);
+    awake = FALSE;
+    thread = Thread::GenThread("pager");
+    thread->Fork(PagerThread, (void *) this);
+}
+
+Pager::~Pager()
+{
+    delete wakeup;
+}
+
+//----------------------------------------------------------------------
+// Pager::FramesFree
+// 	Wake the pager, unless it is awake already, if fewer than the low
+//	watermark of frames are free.
+//----------------------------------------------------------------------
+
+void
+Pager::FramesFree(int numFree)
+{
+    if (numFree < lowWater && !awake) {
+	awake = TRUE;
+	stats->numPagerWakeups++;
+	wakeup->V();
+    }
+}
+
+//----------------------------------------------------------------------
+// Pager::Asleep
+// 	Return TRUE if "thread" is the pager, and it is waiting to be
+//	woken.  A checkpoint can be taken then, leaving the pager out: a
+//	run restored from it has a pager of its own.
+//----------------------------------------------------------------------
+
+bool
+Pager::Asleep(Thread *t)
+{
+    return t == thread && !awake;
+}
+
+//----------------------------------------------------------------------
+// Pager::Run
+// 	Each time the pager is woken, have the core map replace pages
+//	until the high watermark of frames is free, or no more pages can
+//	be replaced now.
+//----------------------------------------------------------------------
+
+void
+Pager::Run()
+{
+    for (;;) {
+	wakeup->P();
+	DEBUG('a', "Pager woken, %d frames free\n", coreMap->NumFree());
+	while (coreMap->NumFree() < highWater && coreMap->Reclaim() != -1)
+	    ;
+	awake = FALSE;
+    }
+}
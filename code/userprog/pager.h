@@ -0,0 +1,49 @@
+// pager.h
+//	Data structures for the pager: a kernel thread that keeps some
+//	frames of physical memory free, so that a page fault can usually
+//	be served by just reading the page in.
+//
+//	With -pager <low> <high>, the pager is woken whenever taking a
+//	frame leaves fewer than "low" of them free.  It then replaces
+//	pages -- writing out those that are dirty -- until "high" frames
+//	are free, or no page can be replaced, and goes back to sleep.
+//	The pages replaced are chosen by the replacement policy, just as
+//	a page fault would choose them.  If a page fault finds no frame
+//	free all the same, it replaces a page itself, as it does with no
+//	pager.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PAGER_H
+#define PAGER_H
+
+#include "copyright.h"
+#include "utility.h"
+#include "synch.h"
+
+class Thread;
+
+// The following class defines the pager.
+
+class Pager {
+  public:
+    Pager(int lowWater, int highWater);	// Start the pager thread
+    ~Pager();
+
+    void FramesFree(int numFree);	// A frame has been taken, leaving
+					// "numFree"; wake the pager if that
+					// is too few
+    bool Asleep(Thread *thread);	// Is "thread" the pager, waiting
+					// for work?
+    void Run();				// The pager thread's loop
+
+  private:
+    int lowWater, highWater;		// frames to keep free
+    Semaphore *wakeup;			// the pager waits here for work
+    bool awake;				// has it been woken?
+    Thread *thread;			// the pager thread
+};
+
+#endif // PAGER_H
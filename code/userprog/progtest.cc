@@ -31,9 +31,8 @@ StartProcess(char *filename)
 	return;
     }
     currentThread->setFileName(filename);
-    space = new AddrSpace(executable);    
+    space = new AddrSpace(executable, filename);	// keeps the file open
     currentThread->space = space;
-    delete executable;			// close file
 
     space->InitRegisters();		// set the initial register values
     space->RestoreState();		// load page table register
@@ -45,6 +44,33 @@ StartProcess(char *filename)
 					// by doing the syscall "exit"
 }
 
+//----------------------------------------------------------------------
+// StartProcesses
+// 	Run the user programs named in "names", separated by commas, all
+//	at once: each is started by a thread of its own, and this thread
+//	finishes.  Runs of one executable share its code pages.  A single
+//	program is just run by this thread.
+//----------------------------------------------------------------------
+
+void
+StartProcesses(char *names)
+{
+    char *copy, *name;
+    Thread *t;
+
+    if (strchr(names, ',') == NULL) {
+	StartProcess(names);
+	return;
+    }
+    copy = new char[strlen(names) + 1];	// the threads keep the names
+    strcpy(copy, names);
+    for (name = strtok(copy, ","); name != NULL; name = strtok(NULL, ",")) {
+	t = Thread::GenThread(name);
+	t->Fork((VoidFunctionPtr) StartProcess, name);
+    }
+    currentThread->Finish();
+}
+
 // Data structures needed for the console test.  Threads making
 // I/O requests wait on a Semaphore to delay until the I/O completes.
 
@@ -0,0 +1,476 @@
+// replacement.cc
+//	Routines to choose the page to replace, for each of the
+//	replacement policies.  See replacement.h.
+//
+//	The core map has brought every page table up to date with the
+//	TLBs before FindVictim is called.  A policy may only choose a
+//	frame for which CoreMap::Replaceable is TRUE.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "replacement.h"
+#include "coremap.h"
+#include "system.h"
+#include "addrspace.h"
+
+//----------------------------------------------------------------------
+// NewReplacementPolicy
+// 	Return the replacement policy chosen on the command line, for
+//	the frames of "core".
+//----------------------------------------------------------------------
+
+ReplacementPolicy *
+NewReplacementPolicy(CoreMap *core)
+{
+    switch (replacementKind) {
+      case ClockReplacement:
+	return new ClockPolicy(core);
+      case WSClockReplacement:
+	return new WSClockPolicy(core);
+      case LRU2Replacement:
+	return new LRU2Policy(core);
+      case ARCReplacement:
+	return new ARCPolicy(core);
+      default:
+	return new LRUPolicy(core);
+    }
+}
+
+//----------------------------------------------------------------------
+// LRUPolicy::FindVictim
+// 	Return the frame whose page was referred to longest ago.
+//----------------------------------------------------------------------
+
+LRUPolicy::LRUPolicy(CoreMap *c)
+{
+    core = c;
+}
+
+int
+LRUPolicy::FindVictim()
+{
+    int victim = -1, oldest = 0;
+
+    for (int i = 0; i < core->NumFrames(); i++) {
+	TranslationEntry *entry;
+
+	stats->numFramesScanned++;
+	if (!core->Replaceable(i))
+	    continue;
+	entry = core->Entry(i);
+	if (victim == -1 || entry->lrutime < oldest) {
+	    victim = i;
+	    oldest = entry->lrutime;
+	}
+    }
+    return victim;
+}
+
+//----------------------------------------------------------------------
+// ClockPolicy::FindVictim
+// 	Sweep the frames from the hand, clearing use bits, until a page
+//	is found whose use bit is already clear.  Two sweeps are enough:
+//	the first clears every use bit there is.
+//----------------------------------------------------------------------
+
+ClockPolicy::ClockPolicy(CoreMap *c)
+{
+    core = c;
+    hand = 0;
+}
+
+int
+ClockPolicy::FindVictim()
+{
+    int numFrames = core->NumFrames();
+
+    for (int i = 0; i < 2 * numFrames; i++) {
+	int frame = hand;
+	TranslationEntry *entry;
+
+	hand = (hand + 1) % numFrames;
+	stats->numFramesScanned++;
+	if (!core->Replaceable(frame))
+	    continue;
+	entry = core->Entry(frame);
+	if (!entry->use)
+	    return frame;
+	entry->use = FALSE;		// second chance
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// WSClockPolicy::FindVictim
+// 	Sweep the frames once from the hand.  A page whose use bit is set
+//	is passed over, and has it cleared; a page that has not been
+//	referred to for WorkingSetWindow references is replaced if it is
+//	clean, and written out (so that it will be clean next time round)
+//	if it is not.
+//
+//	If the sweep finds no clean page out of its working set, replace
+//	the first page it wrote out, or failing that the page referred to
+//	longest ago.  (Not the oldest clean page: that can be the page
+//	just brought in for an instruction that needs two, over and over.)
+//----------------------------------------------------------------------
+
+WSClockPolicy::WSClockPolicy(CoreMap *c)
+{
+    core = c;
+    hand = 0;
+}
+
+int
+WSClockPolicy::FindVictim()
+{
+    int numFrames = core->NumFrames();
+    int cleaned = -1, oldest = -1, oldestTime = 0;
+
+    for (int i = 0; i < numFrames; i++) {
+	int frame = hand;
+	TranslationEntry *entry;
+
+	hand = (hand + 1) % numFrames;
+	stats->numFramesScanned++;
+	if (!core->Replaceable(frame))
+	    continue;
+	entry = core->Entry(frame);
+	if (entry->use)
+	    entry->use = FALSE;
+	else if (Machine::lruClock - entry->lrutime > WorkingSetWindow) {
+	    if (!entry->dirty)
+		return frame;
+	    core->Clean(frame);
+	    if (cleaned == -1)
+		cleaned = frame;
+	    continue;
+	}
+	if (oldest == -1 || entry->lrutime < oldestTime) {
+	    oldest = frame;
+	    oldestTime = entry->lrutime;
+	}
+    }
+    if (cleaned != -1 && core->Replaceable(cleaned))
+	return cleaned;			// unless replaced while being written
+    return oldest;
+}
+
+//----------------------------------------------------------------------
+// LRU2Policy::FindVictim
+// 	Record a reference for each page whose use bit has been set since
+//	the last sample, then return the frame whose page's second most
+//	recent reference is oldest.  Pages not referred to since the
+//	sample in which they were loaded have no second reference, and
+//	go first, least recently used first.
+//
+//	Pages loaded since the last sample are only replaced if there is
+//	nothing else: otherwise an instruction that refers to two pages
+//	that are not in memory could have each replace the other forever.
+//----------------------------------------------------------------------
+
+LRU2Policy::LRU2Policy(CoreMap *c)
+{
+    core = c;
+    last = new int[core->NumFrames()];
+    previous = new int[core->NumFrames()];
+    fresh = new bool[core->NumFrames()];
+    for (int i = 0; i < core->NumFrames(); i++)
+	Loaded(i);
+}
+
+LRU2Policy::~LRU2Policy()
+{
+    delete [] last;
+    delete [] previous;
+    delete [] fresh;
+}
+
+void
+LRU2Policy::Loaded(int frame)
+{
+    last[frame] = previous[frame] = -1;
+    fresh[frame] = TRUE;
+}
+
+int
+LRU2Policy::FindVictim()
+{
+    int victim = -1, young = -1;
+
+    for (int i = 0; i < core->NumFrames(); i++) {
+	TranslationEntry *entry;
+
+	stats->numFramesScanned++;
+	if (!core->Replaceable(i))
+	    continue;
+	entry = core->Entry(i);
+	if (fresh[i]) {			// the reference that loaded it
+	    fresh[i] = FALSE;
+	    last[i] = entry->lrutime;
+	    entry->use = FALSE;
+	    if (young == -1 || last[i] < last[young])
+		young = i;
+	    continue;
+	}
+	if (entry->use) {
+	    previous[i] = last[i];
+	    last[i] = entry->lrutime;
+	    entry->use = FALSE;
+	}
+	if (victim == -1 || previous[i] < previous[victim]
+		|| (previous[i] == previous[victim] && last[i] < last[victim]))
+	    victim = i;
+    }
+    return (victim != -1) ? victim : young;
+}
+
+//----------------------------------------------------------------------
+// ARCPolicy::ARCPolicy
+// 	Start with every frame free, no ghosts, and no frames set aside
+//	for Recent: until a fault shows otherwise, Recent is replaced
+//	first.
+//----------------------------------------------------------------------
+
+ARCPolicy::ARCPolicy(CoreMap *c)
+{
+    core = c;
+    numFrames = core->NumFrames();
+    list = new ARCList[numFrames];
+    stamp = new int[numFrames];
+    fresh = new bool[numFrames];
+    order = new int[numFrames];
+    ghosts = new Ghost[numFrames];
+    for (int i = 0; i < numFrames; i++) {
+	list[i] = NoList;
+	stamp[i] = 0;
+	fresh[i] = FALSE;
+	ghosts[i].space = NULL;
+    }
+    target = 0;
+    clock = 0;
+}
+
+ARCPolicy::~ARCPolicy()
+{
+    delete [] list;
+    delete [] stamp;
+    delete [] fresh;
+    delete [] order;
+    delete [] ghosts;
+}
+
+//----------------------------------------------------------------------
+// ARCPolicy::Loaded
+// 	Put a page just brought in at the front of Recent -- unless it
+//	was replaced recently, in which case it goes on Frequent, and
+//	the list it was replaced from is given more of memory: the
+//	fault shows that list was too short.
+//----------------------------------------------------------------------
+
+void
+ARCPolicy::Loaded(int frame)
+{
+    AddrSpace *space = core->Owner(frame);
+    int vpn = core->Page(frame);
+    int g;
+
+    for (g = 0; g < numFrames; g++)
+	if (ghosts[g].space == space && ghosts[g].vpn == vpn)
+	    break;
+    if (g == numFrames)
+	list[frame] = Recent;
+    else {
+	int recent = Ghosts(Recent), frequent = Ghosts(Frequent);
+
+	if (ghosts[g].list == Recent)
+	    target = min(target + max(1, frequent / recent), numFrames);
+	else
+	    target = max(target - max(1, recent / frequent), 0);
+	ghosts[g].space = NULL;
+	list[frame] = Frequent;
+    }
+    stamp[frame] = ++clock;
+    fresh[frame] = TRUE;
+}
+
+//----------------------------------------------------------------------
+// ARCPolicy::Evicted, ARCPolicy::Freed, ARCPolicy::Forget
+// 	A page replaced becomes a ghost of the list it was on; one that
+//	is gone for good is just dropped, with any ghosts of its
+//	address space.
+//----------------------------------------------------------------------
+
+void
+ARCPolicy::Evicted(int frame)
+{
+    ARCList which = list[frame];
+
+    list[frame] = NoList;
+    if (which != NoList)
+	AddGhost(core->Owner(frame), core->Page(frame), which);
+}
+
+void
+ARCPolicy::Freed(int frame)
+{
+    list[frame] = NoList;
+}
+
+void
+ARCPolicy::Forget(AddrSpace *space)
+{
+    for (int g = 0; g < numFrames; g++)
+	if (ghosts[g].space == space)
+	    ghosts[g].space = NULL;
+}
+
+//----------------------------------------------------------------------
+// ARCPolicy::FindVictim
+// 	Promote the pages used since the last sample, then replace the
+//	least recently used page of Recent if it has more than its share
+//	of memory, or else of Frequent.  As with LRU-2, pages loaded since
+//	the last sample are only replaced if there is nothing else.
+//----------------------------------------------------------------------
+
+int
+ARCPolicy::FindVictim()
+{
+    ARCList first, second;
+    int victim;
+
+    Sample();
+    first = (Residents(Recent) > target) ? Recent : Frequent;
+    second = (first == Recent) ? Frequent : Recent;
+    victim = Oldest(first, FALSE);
+    if (victim == -1)
+	victim = Oldest(second, FALSE);
+    if (victim == -1)
+	victim = Oldest(first, TRUE);
+    if (victim == -1)
+	victim = Oldest(second, TRUE);
+    for (int i = 0; i < numFrames; i++)
+	fresh[i] = FALSE;
+    return victim;
+}
+
+//----------------------------------------------------------------------
+// ARCPolicy::Sample
+// 	Move each page whose use bit has been set since the last sample
+//	to the front of Frequent, most recently referred to first, and
+//	clear its use bit.  A page loaded since the last sample has only
+//	been referred to by the access that brought it in.
+//----------------------------------------------------------------------
+
+void
+ARCPolicy::Sample()
+{
+    int numUsed = 0;
+
+    for (int i = 0; i < numFrames; i++) {
+	TranslationEntry *entry;
+	int j;
+
+	stats->numFramesScanned++;
+	if (list[i] == NoList || !core->Replaceable(i))
+	    continue;
+	entry = core->Entry(i);
+	if (entry->use && !fresh[i]) {	// insert, by reference time
+	    int lrutime = entry->lrutime;
+
+	    for (j = numUsed; j > 0
+		    && core->Entry(order[j - 1])->lrutime > lrutime; j--)
+		order[j] = order[j - 1];
+	    order[j] = i;
+	    numUsed++;
+	}
+	entry->use = FALSE;
+    }
+    for (int j = 0; j < numUsed; j++) {
+	list[order[j]] = Frequent;
+	stamp[order[j]] = ++clock;
+    }
+}
+
+//----------------------------------------------------------------------
+// ARCPolicy::Oldest, ARCPolicy::Residents, ARCPolicy::Ghosts
+// 	Find the least recently used frame on a list that can be
+//	replaced -- if "young", perhaps one loaded since the last
+//	sample -- and count the frames on a list and the ghosts of one.
+//----------------------------------------------------------------------
+
+int
+ARCPolicy::Oldest(ARCList which, bool young)
+{
+    int oldest = -1;
+
+    for (int i = 0; i < numFrames; i++)
+	if (list[i] == which && core->Replaceable(i) && (young || !fresh[i])
+		&& (oldest == -1 || stamp[i] < stamp[oldest]))
+	    oldest = i;
+    return oldest;
+}
+
+int
+ARCPolicy::Residents(ARCList which)
+{
+    int count = 0;
+
+    for (int i = 0; i < numFrames; i++)
+	if (list[i] == which)
+	    count++;
+    return count;
+}
+
+int
+ARCPolicy::Ghosts(ARCList which)
+{
+    int count = 0;
+
+    for (int g = 0; g < numFrames; g++)
+	if (ghosts[g].space != NULL && ghosts[g].list == which)
+	    count++;
+    return count;
+}
+
+//----------------------------------------------------------------------
+// ARCPolicy::AddGhost
+// 	Remember a page replaced from a list.  Ghosts of Recent are kept
+//	to no more than the frames Recent doesn't fill, and there are
+//	never more ghosts than frames; the oldest ghosts are dropped to
+//	make room.
+//----------------------------------------------------------------------
+
+void
+ARCPolicy::AddGhost(AddrSpace *space, int vpn, ARCList which)
+{
+    int g;
+
+    if (which == Recent)
+	while (Ghosts(Recent) > 0
+		&& Residents(Recent) + Ghosts(Recent) >= numFrames)
+	    DropOldestGhost(Recent);
+    if (Ghosts(Recent) + Ghosts(Frequent) >= numFrames)
+	DropOldestGhost(Ghosts(Frequent) > 0 ? Frequent : Recent);
+    for (g = 0; ghosts[g].space != NULL; g++)
+	;
+    ghosts[g].space = space;
+    ghosts[g].vpn = vpn;
+    ghosts[g].list = which;
+    ghosts[g].stamp = ++clock;
+}
+
+void
+ARCPolicy::DropOldestGhost(ARCList which)
+{
+    int oldest = -1;
+
+    for (int g = 0; g < numFrames; g++)
+	if (ghosts[g].space != NULL && ghosts[g].list == which
+		&& (oldest == -1 || ghosts[g].stamp < ghosts[oldest].stamp))
+	    oldest = g;
+    if (oldest != -1)
+	ghosts[oldest].space = NULL;
+}
@@ -0,0 +1,175 @@
+// replacement.h
+//	Data structures for the page replacement policies: how the core
+//	map chooses which page to take out of memory when a page fault
+//	finds no frame free.
+//
+//	The policy is chosen with -replace:
+//
+//	lru -- the page referred to longest ago, by the reference times
+//		the TLBs keep (the default)
+//	clock -- second chance: the frames are swept in order, and a page
+//		whose use bit is set has it cleared, and is passed over
+//	wsclock -- the clock, except that a page stays in the working set
+//		until WorkingSetWindow references to memory have been made
+//		since its last; dirty pages out of the working set are
+//		written out as the hand passes, and the first clean one is
+//		replaced
+//	lru2 -- the page whose second most recent reference is oldest;
+//		pages referred to only once go first
+//	arc -- adaptive replacement: pages referred to once and pages
+//		referred to again are kept on separate lists, and the share
+//		of memory each gets adapts to faults on pages recently
+//		replaced from either
+//
+//	The machine has no reference history beyond the use bits and
+//	reference times in the page tables, so the policies that keep one
+//	(lru2, arc) sample the use bits each time a page is to be
+//	replaced: a page is counted as referred to again if its use bit
+//	has been set since the last time.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef REPLACEMENT_H
+#define REPLACEMENT_H
+
+#include "copyright.h"
+#include "utility.h"
+
+#define WorkingSetWindow	5000	// references to memory a page stays
+					// in the working set after its last,
+					// for wsclock
+
+class AddrSpace;
+class CoreMap;
+
+enum ReplacementKind { LRUReplacement, ClockReplacement, WSClockReplacement,
+		       LRU2Replacement, ARCReplacement };
+
+// The following class defines the interface to a replacement policy.
+// The core map tells it as pages come and go; only FindVictim has to
+// be provided.
+
+class ReplacementPolicy {
+  public:
+    virtual ~ReplacementPolicy() {}
+
+    virtual void Loaded(int frame) {}	// A page has been mapped in the frame
+    virtual void Evicted(int frame) {}	// The page in the frame has been
+					// replaced, and written out
+    virtual void Freed(int frame) {}	// The page in the frame is gone, as
+					// its program has exited
+    virtual void Forget(AddrSpace *space) {}
+					// "space" is going away; drop any
+					// history of its pages
+    virtual int FindVictim() = 0;	// Return the frame to replace, or -1
+					// if no frame can be replaced now
+};
+
+extern ReplacementPolicy *NewReplacementPolicy(CoreMap *core);
+					// The policy chosen with -replace
+
+// Least recently used, by reference time.
+
+class LRUPolicy : public ReplacementPolicy {
+  public:
+    LRUPolicy(CoreMap *core);
+
+    int FindVictim();
+
+  private:
+    CoreMap *core;
+};
+
+// Second chance.
+
+class ClockPolicy : public ReplacementPolicy {
+  public:
+    ClockPolicy(CoreMap *core);
+
+    int FindVictim();
+
+  private:
+    CoreMap *core;
+    int hand;				// the next frame to look at
+};
+
+// The working set clock.
+
+class WSClockPolicy : public ReplacementPolicy {
+  public:
+    WSClockPolicy(CoreMap *core);
+
+    int FindVictim();
+
+  private:
+    CoreMap *core;
+    int hand;				// the next frame to look at
+};
+
+// LRU-2.
+
+class LRU2Policy : public ReplacementPolicy {
+  public:
+    LRU2Policy(CoreMap *core);
+    ~LRU2Policy();
+
+    void Loaded(int frame);
+    int FindVictim();
+
+  private:
+    CoreMap *core;
+    int *last;				// reference time of each frame's page
+					// when last seen in use
+    int *previous;			// and the time before that, or -1
+    bool *fresh;			// loaded since the last sample
+};
+
+// Adaptive replacement.
+
+class ARCPolicy : public ReplacementPolicy {
+  public:
+    ARCPolicy(CoreMap *core);
+    ~ARCPolicy();
+
+    void Loaded(int frame);
+    void Evicted(int frame);
+    void Freed(int frame);
+    void Forget(AddrSpace *space);
+    int FindVictim();
+
+  private:
+    enum ARCList { NoList, Recent, Frequent };
+
+    // A page recently replaced: a "ghost", of which only the name is
+    // remembered.
+    typedef struct {
+	AddrSpace *space;
+	int vpn;
+	ARCList list;			// which list it was replaced from
+	int stamp;			// when
+    } Ghost;
+
+    void Sample();			// Move pages used again to Frequent
+    int Oldest(ARCList which, bool young);
+					// Its least recently used frame that
+					// can be replaced, or -1
+    int Residents(ARCList which);	// How many frames are on a list
+    int Ghosts(ARCList which);		// How many ghosts came from a list
+    void AddGhost(AddrSpace *space, int vpn, ARCList which);
+    void DropOldestGhost(ARCList which);
+
+    CoreMap *core;
+    int numFrames;
+    ARCList *list;			// the list each frame is on
+    int *stamp;				// when it went to the front of it
+    bool *fresh;			// loaded since the last sample
+    int *order;				// scratch space for Sample
+    Ghost *ghosts;			// numFrames of them; unused ones have
+					// a NULL space
+    int target;				// frames Recent should have
+    int clock;				// stamps are taken from here
+};
+
+#endif // REPLACEMENT_H
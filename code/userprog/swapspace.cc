@@ -0,0 +1,182 @@
+// swapspace.cc
+//	Routines to allocate the slots of the swap space, and to move
+//	pages in and out of them.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "swapspace.h"
+#include "system.h"
+#include "sysdep.h"
+
+//----------------------------------------------------------------------
+// SwapSpace::SwapSpace
+// 	Set up an empty swap space.  The file is not touched until a page
+//	is written to it, so that runs with no user programs never
+//	create it.
+//
+//	On the Nachos file system, a swap file left on the disk by an
+//	earlier run is kept, and by default sets the size; otherwise the
+//	default is half the free space on the disk, or the largest file
+//	that could be created, if that is smaller.
+//
+//	"name" -- the swap file
+//	"n" -- how many pages it holds, or 0 for the default; the file
+//	system must be up already, to size it from the free sectors
+//----------------------------------------------------------------------
+
+SwapSpace::SwapSpace(char *name, int n)
+{
+    fileName = name;
+    file = NULL;
+    if (n == 0) {
+#ifdef FILESYS
+	file = fileSystem->Open(fileName);
+	if (file != NULL)
+	    n = file->Length() / PageSize;
+	else
+	    n = min(fileSystem->LargestFile(),
+		    fileSystem->FreeSectors() / 2 * SectorSize) / PageSize;
+#else
+	n = DefaultNumSwapPages;
+#endif
+	DEBUG('a', "Swap space of %d pages\n", n);
+    }
+    numSlots = n;
+    slots = new BitMap(numSlots);
+    refs = new int[numSlots];
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::~SwapSpace
+// 	Close the swap file, and remove it.  On the Nachos file system it
+//	is left for the next run instead, as Nachos may be halting from
+//	Interrupt::Idle, where the disk can no longer be waited for.
+//----------------------------------------------------------------------
+
+SwapSpace::~SwapSpace()
+{
+    if (file != NULL) {
+	delete file;
+#ifndef FILESYS
+	fileSystem->Remove(fileName);
+#endif
+    }
+    delete slots;
+    delete [] refs;
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::Allocate
+// 	Return a free slot, marking it in use by one page.  Running out of
+//	swap space is fatal.
+//----------------------------------------------------------------------
+
+int
+SwapSpace::Allocate()
+{
+    int slot = slots->Find();
+
+    if (slot == -1) {
+	printf("Out of swap space (%d pages); use -swapsize.\n", numSlots);
+	ASSERT(FALSE);
+    }
+    refs[slot] = 1;
+    return slot;
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::Share, SwapSpace::Free, SwapSpace::Claim
+// 	Count a page in or out of those sharing a slot; the slot is free
+//	again when the last one leaves.
+//----------------------------------------------------------------------
+
+void
+SwapSpace::Share(int slot)
+{
+    ASSERT(slots->Test(slot));
+    refs[slot]++;
+}
+
+void
+SwapSpace::Free(int slot)
+{
+    ASSERT(slots->Test(slot));
+    if (--refs[slot] == 0)
+	slots->Clear(slot);
+}
+
+void
+SwapSpace::Claim(int slot)
+{
+    if (slots->Test(slot))
+	refs[slot]++;
+    else {
+	slots->Mark(slot);
+	refs[slot] = 1;
+    }
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::ReadPage, SwapSpace::WritePage
+// 	Move a page between a slot and a page-sized buffer (usually a
+//	frame of main memory).
+//----------------------------------------------------------------------
+
+void
+SwapSpace::ReadPage(int slot, char *into)
+{
+    ASSERT(slots->Test(slot));
+    File()->ReadAt(into, PageSize, slot * PageSize);
+}
+
+void
+SwapSpace::ReadPages(int slot, int n, char *into)
+{
+    for (int i = slot; i < slot + n; i++)
+	ASSERT(slots->Test(i));
+    File()->ReadAt(into, n * PageSize, slot * PageSize);
+}
+
+void
+SwapSpace::WritePage(int slot, char *from)
+{
+    ASSERT(slots->Test(slot));
+    File()->WriteAt(from, PageSize, slot * PageSize);
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::File
+// 	Return the open swap file, opening it the first time.  A file
+//	left by a checkpoint being restored is used as it is.
+//
+//	If there isn't room for the file -- the disk has filled up since
+//	Nachos started, or -swapsize asked for too much -- nothing more
+//	can be paged out, so stop.
+//----------------------------------------------------------------------
+
+OpenFile *
+SwapSpace::File()
+{
+    if (file == NULL) {
+	file = fileSystem->Open(fileName);
+#ifdef FILESYS
+	if (file != NULL && file->Length() < numSlots * PageSize) {
+	    delete file;			// too small; make a new one
+	    fileSystem->Remove(fileName);
+	    file = NULL;
+	}
+#endif
+	if (file == NULL && fileSystem->Create(fileName, numSlots * PageSize))
+	    file = fileSystem->Open(fileName);
+	if (file == NULL) {
+	    printf("Can't create swap file %s of %d pages (%d bytes); "
+		   "the disk is too full, or use a smaller -swapsize.\n",
+		   fileName, numSlots, numSlots * PageSize);
+	    Exit(1);
+	}
+    }
+    return file;
+}
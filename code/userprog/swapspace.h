@@ -0,0 +1,73 @@
+// swapspace.h
+//	Data structures for the swap space: the one file that holds the
+//	pages of every address space that are not in main memory.
+//
+//	The file is divided into slots of one page each.  A slot is
+//	allocated to a virtual page of an address space the first time
+//	the page is written out, and from then on holds the page's
+//	contents whenever it is out of memory (before that, the page is
+//	read from the program's executable).  The file is opened the
+//	first time it is used, and stays open until Nachos halts, when
+//	it is removed.  On the Nachos file system, the file is created
+//	with all its sectors, so by default it only takes half of those
+//	that are free when Nachos starts, leaving the rest for the files
+//	programs write; it stays on the disk, for the next run to use.
+//
+//	After a Fork, a slot can hold a page of several address spaces,
+//	which share it copy-on-write; each slot keeps a count of the pages
+//	that share it, and is only free when none does.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SWAPSPACE_H
+#define SWAPSPACE_H
+
+#include "copyright.h"
+#include "utility.h"
+#include "bitmap.h"
+#include "filesys.h"
+
+#define SwapFileName		"SWAP"
+#define DefaultNumSwapPages	4096	// slots, unless -swapsize says,
+					// on the host's file system
+
+// The following class defines the swap space.
+
+class SwapSpace {
+  public:
+    SwapSpace(char *name, int numSlots);
+					// A swap space of "numSlots" pages,
+					// in the file "name"; 0 for the
+					// default size
+    ~SwapSpace();			// Close the file, and remove it
+
+    int Allocate();			// Find a free slot
+    void Share(int slot);		// Another page shares a slot
+    void Free(int slot);		// A page gives a slot back
+    bool Shared(int slot) { return refs[slot] > 1; }
+    void Claim(int slot);		// Mark a slot in use by one more
+					// page, for a checkpoint being
+					// restored
+
+    void ReadPage(int slot, char *into);
+					// Read a page out of a slot
+    void ReadPages(int slot, int n, char *into);
+					// Read the pages out of "n" slots
+					// in a row, at once
+    void WritePage(int slot, char *from);
+					// Write a page into a slot
+    char *Name() { return fileName; }
+
+  private:
+    OpenFile *File();			// The file, opened if need be
+
+    char *fileName;			// where the slots are
+    OpenFile *file;			// NULL until first used
+    BitMap *slots;			// which slots are in use
+    int *refs;				// how many pages share each slot
+    int numSlots;
+};
+
+#endif // SWAPSPACE_H